@@ -0,0 +1,558 @@
+//
+//  TWMessageBarBenchmark.c
+//
+//  Created by Terry Worona on 5/13/13.
+//  Copyright (c) 2013 Terry Worona. All rights reserved.
+//
+//  Microbenchmarks for TWMessageBarCore and drain runs on the simulation. Prints a single JSON document to stdout:
+//  {"benchmarks": [{"name": ..., "operations": N, "median_ns": x, "min_ns": y}, ...],
+//   "drains": [{"name": ..., "messages": N, "drain_s": t, "messages_per_minute": r}, ...]}
+//  where the benchmark times are per operation and drains are in simulated seconds. Pass --quick for a smoke run.
+//
+
+#include "TWMessageBarBlurReference.h"
+#include "TWMessageBarCore.h"
+#include "TWMessageBarSimulation.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Numerics
+#define TW_BENCHMARK_REPETITIONS 9
+#define TW_BENCHMARK_QUICK_REPETITIONS 2
+#define TW_BENCHMARK_RANDOM_COUNT 4096 // power of two
+#define TW_BENCHMARK_STACK_COUNT 8
+#define TW_BENCHMARK_TIMER_COUNT 8 // one per bar on screen
+#define TW_BENCHMARK_DRAIN_MESSAGE_COUNT 100
+
+static int kTWMessageBarBenchmarkQuick = 0;
+static size_t kTWMessageBarBenchmarkReportedCount = 0;
+static size_t kTWMessageBarBenchmarkDrainReportedCount = 0;
+static volatile uint64_t kTWMessageBarBenchmarkSink = 0; // keeps results observable
+static uint64_t kTWMessageBarBenchmarkRandom[TW_BENCHMARK_RANDOM_COUNT];
+
+typedef struct {
+    TWMessageBarQueue queue;
+    TWMessageBarQueueEntry *entries;
+    TWMessageBarTimerQueue timers;
+    TWMessageBarPolicyRecord policies[64];
+    TWMessageBarTextLayoutCache textLayouts;
+    TWMessageBarHistogram histogram;
+    uint16_t *characters;
+    uint8_t *pixels;
+    void *scratch;
+    size_t width;
+    size_t height;
+    size_t radius;
+} TWMessageBarBenchmarkContext;
+
+// Harness
+
+static uint64_t TWMessageBarBenchmarkNow(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return ((uint64_t)now.tv_sec * 1000000000ULL) + (uint64_t)now.tv_nsec;
+}
+
+static int TWMessageBarBenchmarkCompareSamples(const void *sample1, const void *sample2)
+{
+    double difference = *(const double *)sample1 - *(const double *)sample2;
+    return difference < 0.0 ? -1 : (difference > 0.0 ? 1 : 0);
+}
+
+/*
+ * Runs body over `operations` operations several times, with setUp and tearDown outside the timed region,
+ * and reports the median and fastest time per operation.
+ */
+static void TWMessageBarBenchmarkRun(const char *name, size_t operations, void (*setUp)(TWMessageBarBenchmarkContext *, size_t), uint64_t (*body)(TWMessageBarBenchmarkContext *, size_t), void (*tearDown)(TWMessageBarBenchmarkContext *))
+{
+    TWMessageBarBenchmarkContext context;
+    double samples[TW_BENCHMARK_REPETITIONS];
+    size_t repetitions = kTWMessageBarBenchmarkQuick ? TW_BENCHMARK_QUICK_REPETITIONS : TW_BENCHMARK_REPETITIONS;
+    operations = kTWMessageBarBenchmarkQuick ? (operations + 99) / 100 : operations;
+    
+    for (size_t repetition = 0; repetition < repetitions; repetition++)
+    {
+        memset(&context, 0, sizeof(context));
+        if (setUp)
+        {
+            setUp(&context, operations);
+        }
+        uint64_t start = TWMessageBarBenchmarkNow();
+        kTWMessageBarBenchmarkSink += body(&context, operations);
+        uint64_t end = TWMessageBarBenchmarkNow();
+        if (tearDown)
+        {
+            tearDown(&context);
+        }
+        samples[repetition] = (double)(end - start) / (double)operations;
+    }
+    
+    qsort(samples, repetitions, sizeof(double), TWMessageBarBenchmarkCompareSamples);
+    printf("%s    {\"name\": \"%s\", \"operations\": %zu, \"median_ns\": %.2f, \"min_ns\": %.2f}", kTWMessageBarBenchmarkReportedCount > 0 ? ",\n" : "", name, operations, samples[repetitions / 2], samples[0]);
+    kTWMessageBarBenchmarkReportedCount++;
+}
+
+static void TWMessageBarBenchmarkSeedRandom(void)
+{
+    uint64_t state = 0x9E3779B97F4A7C15ULL; // xorshift64; fixed, so every run sees the same inputs
+    for (size_t i = 0; i < TW_BENCHMARK_RANDOM_COUNT; i++)
+    {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        kTWMessageBarBenchmarkRandom[i] = state;
+    }
+}
+
+static inline uint64_t TWMessageBarBenchmarkRandomAtIndex(size_t index)
+{
+    return kTWMessageBarBenchmarkRandom[index & (TW_BENCHMARK_RANDOM_COUNT - 1)];
+}
+
+// Message Queue
+
+static void TWMessageBarBenchmarkQueueTearDown(TWMessageBarBenchmarkContext *context)
+{
+    TWMessageBarQueueRemoveAll(&context->queue);
+    free(context->entries);
+}
+
+static void TWMessageBarBenchmarkQueueFill(TWMessageBarBenchmarkContext *context, size_t operations)
+{
+    for (size_t i = 0; i < operations; i++)
+    {
+        TWMessageBarQueueEnqueue(&context->queue, (void *)(uintptr_t)(i + 1), 0);
+    }
+}
+
+static void TWMessageBarBenchmarkQueueBatchSetUp(TWMessageBarBenchmarkContext *context, size_t operations)
+{
+    // Half already queued, half arriving as one batch; mixed priorities force the merge
+    for (size_t i = 0; i < operations; i++)
+    {
+        TWMessageBarQueueEnqueue(&context->queue, (void *)(uintptr_t)(i + 1), (long)(TWMessageBarBenchmarkRandomAtIndex(i) % 4));
+    }
+    context->entries = (TWMessageBarQueueEntry *)malloc(operations * sizeof(TWMessageBarQueueEntry));
+    for (size_t i = 0; i < operations; i++)
+    {
+        context->entries[i].payload = (void *)(uintptr_t)(operations + i + 1);
+        context->entries[i].priority = (long)(TWMessageBarBenchmarkRandomAtIndex(operations + i) % 4);
+    }
+}
+
+static uint64_t TWMessageBarBenchmarkQueueEnqueue(TWMessageBarBenchmarkContext *context, size_t operations)
+{
+    for (size_t i = 0; i < operations; i++)
+    {
+        TWMessageBarQueueEnqueue(&context->queue, (void *)(uintptr_t)(i + 1), 0);
+    }
+    return context->queue.count;
+}
+
+static uint64_t TWMessageBarBenchmarkQueueEnqueueMixedPriority(TWMessageBarBenchmarkContext *context, size_t operations)
+{
+    for (size_t i = 0; i < operations; i++)
+    {
+        TWMessageBarQueueEnqueue(&context->queue, (void *)(uintptr_t)(i + 1), (long)(TWMessageBarBenchmarkRandomAtIndex(i) % 4));
+    }
+    return context->queue.count;
+}
+
+static uint64_t TWMessageBarBenchmarkQueueEnqueueBatch(TWMessageBarBenchmarkContext *context, size_t operations)
+{
+    TWMessageBarQueueEnqueueEntries(&context->queue, context->entries, operations);
+    return context->queue.count;
+}
+
+static uint64_t TWMessageBarBenchmarkQueueDequeue(TWMessageBarBenchmarkContext *context, size_t operations)
+{
+    uint64_t checksum = 0;
+    for (size_t i = 0; i < operations; i++)
+    {
+        checksum += (uintptr_t)TWMessageBarQueueDequeue(&context->queue);
+    }
+    return checksum;
+}
+
+// Style Resolution
+
+static void TWMessageBarBenchmarkPolicySetUp(TWMessageBarBenchmarkContext *context, size_t operations)
+{
+    (void)operations;
+    for (size_t type = 0; type < 64; type++)
+    {
+        TWMessageBarPolicyRecord policy;
+        memset(&policy, 0, sizeof(policy));
+        policy.duration = (double)(type % 3);
+        policy.priority = (long)(type % 4);
+        context->policies[type] = TWMessageBarPolicyRecordCompile(policy, 3.0);
+    }
+}
+
+static uint64_t TWMessageBarBenchmarkPolicyResolve(TWMessageBarBenchmarkContext *context, size_t operations)
+{
+    uint64_t checksum = 0;
+    for (size_t i = 0; i < operations; i++)
+    {
+        uint64_t random = TWMessageBarBenchmarkRandomAtIndex(i);
+        TWMessageBarPresentation presentation = {1.5, 0, 1, 1};
+        TWMessageBarPolicyResolve(&context->policies[random % 64], (TWMessageBarMessageOverrides)((random >> 8) & 7), &presentation);
+        checksum += (uint64_t)presentation.duration + (uint64_t)presentation.priority;
+    }
+    return checksum;
+}
+
+// Text Layouts
+
+static void TWMessageBarBenchmarkTextLayoutSetUp(TWMessageBarBenchmarkContext *context, size_t operations)
+{
+    (void)operations;
+    static const double widths[TW_TEXT_LAYOUT_CACHE_COUNT] = {274.0, 621.0, 329.0, 690.0}; // portrait & landscape, two phones
+    for (size_t i = 0; i < TW_TEXT_LAYOUT_CACHE_COUNT; i++)
+    {
+        TWMessageBarTextLayout textLayout = {widths[i], 300.0 - (double)i, widths[i] * 0.5, 17.0, widths[i], 34.0};
+        TWMessageBarTextLayoutCacheInsert(&context->textLayouts, &textLayout);
+    }
+}
+
+static uint64_t TWMessageBarBenchmarkTextLayoutLookup(TWMessageBarBenchmarkContext *context, size_t operations)
+{
+    uint64_t checksum = 0;
+    for (size_t i = 0; i < operations; i++)
+    {
+        size_t index = (size_t)(TWMessageBarBenchmarkRandomAtIndex(i) % TW_TEXT_LAYOUT_CACHE_COUNT);
+        const TWMessageBarTextLayout *textLayout = TWMessageBarTextLayoutCacheLookup(&context->textLayouts, context->textLayouts.layouts[index].availableWidth, context->textLayouts.layouts[index].maximumTextHeight);
+        checksum += textLayout != NULL ? (uint64_t)textLayout->titleHeight : 0;
+    }
+    return checksum;
+}
+
+static uint64_t TWMessageBarBenchmarkTextLayoutMiss(TWMessageBarBenchmarkContext *context, size_t operations)
+{
+    uint64_t checksum = 0;
+    for (size_t i = 0; i < operations; i++)
+    {
+        checksum += TWMessageBarTextLayoutCacheLookup(&context->textLayouts, 1000.0 + (double)(i & 7), 300.0) == NULL;
+    }
+    return checksum;
+}
+
+// Timers
+
+static void TWMessageBarBenchmarkTimersTearDown(TWMessageBarBenchmarkContext *context)
+{
+    TWMessageBarTimerQueueRemoveAll(&context->timers);
+}
+
+static void TWMessageBarBenchmarkTimersVisibleSetUp(TWMessageBarBenchmarkContext *context, size_t operations)
+{
+    (void)operations;
+    for (size_t i = 0; i < TW_BENCHMARK_TIMER_COUNT; i++)
+    {
+        TWMessageBarTimerQueueSchedule(&context->timers, 3.0 + (double)i * 0.25, (void *)(uintptr_t)(i + 1));
+    }
+}
+
+static uint64_t TWMessageBarBenchmarkTimersReschedule(TWMessageBarBenchmarkContext *context, size_t operations)
+{
+    // A coalesced message or a released pan restarts its bar's dismiss timer
+    uint64_t checksum = 0;
+    for (size_t i = 0; i < operations; i++)
+    {
+        void *payload = (void *)(uintptr_t)((TWMessageBarBenchmarkRandomAtIndex(i) % TW_BENCHMARK_TIMER_COUNT) + 1);
+        checksum += (uint64_t)TWMessageBarTimerQueueCancel(&context->timers, payload);
+        TWMessageBarTimerQueueSchedule(&context->timers, 3.0 + (double)i * 0.001, payload);
+    }
+    return checksum;
+}
+
+static uint64_t TWMessageBarBenchmarkTimersScheduleAndFire(TWMessageBarBenchmarkContext *context, size_t operations)
+{
+    for (size_t i = 0; i < operations; i++)
+    {
+        TWMessageBarTimerQueueSchedule(&context->timers, (double)(TWMessageBarBenchmarkRandomAtIndex(i) % 100000) * 0.001, (void *)(uintptr_t)(i + 1));
+    }
+    uint64_t checksum = 0;
+    TWMessageBarTimer timer;
+    while (TWMessageBarTimerQueuePopDue(&context->timers, 1000.0, &timer))
+    {
+        checksum += (uintptr_t)timer.payload;
+    }
+    return checksum;
+}
+
+// Layout
+
+static uint64_t TWMessageBarBenchmarkStackLayout(TWMessageBarBenchmarkContext *context, size_t operations, int collapsed)
+{
+    (void)context;
+    double heights[TW_BENCHMARK_STACK_COUNT] = {84.0, 64.0, 104.0, 64.0, 84.0, 64.0, 124.0, 64.0};
+    double offsets[TW_BENCHMARK_STACK_COUNT];
+    uint64_t checksum = 0;
+    for (size_t i = 0; i < operations; i++)
+    {
+        heights[i & (TW_BENCHMARK_STACK_COUNT - 1)] += 1.0; // a bar changed height (coalesced text); reflow from the top
+        TWMessageBarStackLayout(heights, offsets, TW_BENCHMARK_STACK_COUNT, 0, 20.0, 6.0, collapsed);
+        checksum += (uint64_t)offsets[TW_BENCHMARK_STACK_COUNT - 1];
+    }
+    return checksum;
+}
+
+static uint64_t TWMessageBarBenchmarkStackLayoutVertical(TWMessageBarBenchmarkContext *context, size_t operations)
+{
+    return TWMessageBarBenchmarkStackLayout(context, operations, 0);
+}
+
+static uint64_t TWMessageBarBenchmarkStackLayoutCollapsed(TWMessageBarBenchmarkContext *context, size_t operations)
+{
+    return TWMessageBarBenchmarkStackLayout(context, operations, 1);
+}
+
+static uint64_t TWMessageBarBenchmarkSpringSettle(TWMessageBarBenchmarkContext *context, size_t operations)
+{
+    // One slide in per operation, stepped at 60 Hz the way the animator's clock ticks
+    (void)context;
+    uint64_t frames = 0;
+    for (size_t i = 0; i < operations; i++)
+    {
+        TWMessageBarSpring spring = TWMessageBarSpringMake(-84.0 - (double)(i & 15), 0.0, 0.0, 0.25);
+        while (!TWMessageBarSpringIsSettled(&spring, 0.5, 10.0))
+        {
+            TWMessageBarSpringStep(&spring, 1.0 / 60.0);
+            frames++;
+        }
+    }
+    return frames;
+}
+
+// Histogram
+
+static uint64_t TWMessageBarBenchmarkHistogramRecord(TWMessageBarBenchmarkContext *context, size_t operations)
+{
+    for (size_t i = 0; i < operations; i++)
+    {
+        TWMessageBarHistogramRecord(&context->histogram, TWMessageBarBenchmarkRandomAtIndex(i) >> (i & 31));
+    }
+    return context->histogram.totalCount;
+}
+
+static void TWMessageBarBenchmarkHistogramSetUp(TWMessageBarBenchmarkContext *context, size_t operations)
+{
+    (void)operations;
+    for (size_t i = 0; i < TW_BENCHMARK_RANDOM_COUNT; i++)
+    {
+        TWMessageBarHistogramRecord(&context->histogram, TWMessageBarBenchmarkRandomAtIndex(i) % 5000000);
+    }
+}
+
+static uint64_t TWMessageBarBenchmarkHistogramPercentiles(TWMessageBarBenchmarkContext *context, size_t operations)
+{
+    static const double percentiles[3] = {50.0, 90.0, 99.0};
+    uint64_t values[3];
+    uint64_t checksum = 0;
+    for (size_t i = 0; i < operations; i++)
+    {
+        TWMessageBarHistogramValuesAtPercentiles(&context->histogram, percentiles, values, 3);
+        checksum += values[2];
+    }
+    return checksum;
+}
+
+// Text
+
+static void TWMessageBarBenchmarkTextSetUp(TWMessageBarBenchmarkContext *context, size_t operations)
+{
+    (void)operations;
+    static const char lorem[] = "Lorem ipsum dolor sit amet, consectetur adipiscing elit. ";
+    context->characters = (uint16_t *)malloc(TW_TEXT_MAXIMUM_CHARACTERS * 4 * sizeof(uint16_t));
+    for (size_t i = 0; i < TW_TEXT_MAXIMUM_CHARACTERS * 4; i++)
+    {
+        context->characters[i] = (uint16_t)lorem[i % (sizeof(lorem) - 1)];
+    }
+}
+
+static void TWMessageBarBenchmarkTextTearDown(TWMessageBarBenchmarkContext *context)
+{
+    free(context->characters);
+}
+
+static uint64_t TWMessageBarBenchmarkTextClamp(TWMessageBarBenchmarkContext *context, size_t operations)
+{
+    uint64_t checksum = 0;
+    for (size_t i = 0; i < operations; i++)
+    {
+        checksum += TWMessageBarTextClampedLength(context->characters, TW_TEXT_MAXIMUM_CHARACTERS * 4, TW_TEXT_MAXIMUM_CHARACTERS, TW_TEXT_MAXIMUM_LINES);
+    }
+    return checksum;
+}
+
+static uint64_t TWMessageBarBenchmarkTextScan(TWMessageBarBenchmarkContext *context, size_t operations, size_t length)
+{
+    uint64_t checksum = 0;
+    for (size_t i = 0; i < operations; i++)
+    {
+        TWMessageBarTextScan scan = TWMessageBarTextScanCharacters(context->characters + (i & 7), length);
+        checksum += scan.newlineCount + (uint64_t)scan.asciiOnly + (uint64_t)scan.complex;
+    }
+    return checksum;
+}
+
+static uint64_t TWMessageBarBenchmarkTextScanTitle(TWMessageBarBenchmarkContext *context, size_t operations)
+{
+    return TWMessageBarBenchmarkTextScan(context, operations, 24);
+}
+
+static uint64_t TWMessageBarBenchmarkTextScanMaximum(TWMessageBarBenchmarkContext *context, size_t operations)
+{
+    return TWMessageBarBenchmarkTextScan(context, operations, TW_TEXT_MAXIMUM_CHARACTERS);
+}
+
+// Blur
+
+static void TWMessageBarBenchmarkBlurSetUp(TWMessageBarBenchmarkContext *context, size_t width, size_t height, size_t radius)
+{
+    context->width = width;
+    context->height = height;
+    context->radius = radius;
+    context->pixels = (uint8_t *)malloc(width * height * 4);
+    for (size_t i = 0; i < width * height * 4; i++)
+    {
+        context->pixels[i] = (uint8_t)TWMessageBarBenchmarkRandomAtIndex(i);
+    }
+    if (posix_memalign(&context->scratch, 64, TWMessageBarBoxBlurScratchSize(width, height)) != 0)
+    {
+        context->scratch = NULL;
+    }
+}
+
+static void TWMessageBarBenchmarkBlurBarSetUp(TWMessageBarBenchmarkContext *context, size_t operations)
+{
+    // A 375x84 pt bar at 4 points per pixel, 20 pt radius
+    (void)operations;
+    TWMessageBarBenchmarkBlurSetUp(context, 96, 24, 5);
+}
+
+static void TWMessageBarBenchmarkBlurLandscapeSetUp(TWMessageBarBenchmarkContext *context, size_t operations)
+{
+    // A 1024x240 pt stack at 4 points per pixel, 32 pt radius
+    (void)operations;
+    TWMessageBarBenchmarkBlurSetUp(context, 256, 60, 8);
+}
+
+static void TWMessageBarBenchmarkBlurTearDown(TWMessageBarBenchmarkContext *context)
+{
+    free(context->pixels);
+    free(context->scratch);
+}
+
+static uint64_t TWMessageBarBenchmarkBlur(TWMessageBarBenchmarkContext *context, size_t operations)
+{
+    for (size_t i = 0; i < operations; i++)
+    {
+        TWMessageBarBoxBlur(context->pixels, context->width, context->height, context->radius, context->scratch);
+    }
+    return context->pixels[0];
+}
+
+static uint64_t TWMessageBarBenchmarkBlurReference(TWMessageBarBenchmarkContext *context, size_t operations)
+{
+    for (size_t i = 0; i < operations; i++)
+    {
+        TWMessageBarBoxBlurReference(context->pixels, context->width, context->height, context->radius);
+    }
+    return context->pixels[0];
+}
+
+// Drains
+
+/*
+ * Simulated time to present and clear a backlog queued all at once. Deterministic, so it runs once.
+ */
+static void TWMessageBarBenchmarkDrain(const char *name, const TWMessageBarSimulationConfiguration *configuration)
+{
+    TWMessageBarProducer producer = {TWMessageBarSimulationActionShow, 0.0, 0.0, TW_BENCHMARK_DRAIN_MESSAGE_COUNT, 0};
+    TWMessageBarSimulationResult result;
+    if (!TWMessageBarSimulationRun(configuration, &producer, 1, &result) || result.drainTime <= 0.0)
+    {
+        TWMessageBarSimulationResultFree(&result);
+        return;
+    }
+    
+    printf("%s    {\"name\": \"%s\", \"messages\": %zu, \"drain_s\": %.2f, \"messages_per_minute\": %.2f, \"peak_bytes\": %zu}", kTWMessageBarBenchmarkDrainReportedCount > 0 ? ",\n" : "", name, result.presentedCount, result.drainTime, (result.presentedCount * 60.0) / result.drainTime, result.peakBytes);
+    kTWMessageBarBenchmarkDrainReportedCount++;
+    TWMessageBarSimulationResultFree(&result);
+}
+
+static void TWMessageBarBenchmarkHandoffDrain(const char *name, TWMessageBarHandoffMode handoffMode)
+{
+    TWMessageBarSimulationConfiguration configuration = TWMessageBarSimulationConfigurationDefault();
+    configuration.handoffMode = handoffMode;
+    TWMessageBarBenchmarkDrain(name, &configuration);
+}
+
+static void TWMessageBarBenchmarkStackDrain(const char *name, size_t maximumVisibleMessages, int collapsed)
+{
+    TWMessageBarSimulationConfiguration configuration = TWMessageBarSimulationConfigurationDefault();
+    configuration.maximumVisibleMessages = maximumVisibleMessages;
+    configuration.collapsed = collapsed;
+    TWMessageBarBenchmarkDrain(name, &configuration);
+}
+
+// Main
+
+int main(int argc, char **argv)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        kTWMessageBarBenchmarkQuick |= strcmp(argv[i], "--quick") == 0;
+    }
+    TWMessageBarBenchmarkSeedRandom();
+    
+    printf("{\"benchmarks\": [\n");
+    
+    TWMessageBarBenchmarkRun("queue_enqueue", 100000, NULL, TWMessageBarBenchmarkQueueEnqueue, TWMessageBarBenchmarkQueueTearDown);
+    TWMessageBarBenchmarkRun("queue_enqueue_mixed_priority", 10000, NULL, TWMessageBarBenchmarkQueueEnqueueMixedPriority, TWMessageBarBenchmarkQueueTearDown);
+    TWMessageBarBenchmarkRun("queue_enqueue_batch", 10000, TWMessageBarBenchmarkQueueBatchSetUp, TWMessageBarBenchmarkQueueEnqueueBatch, TWMessageBarBenchmarkQueueTearDown);
+    TWMessageBarBenchmarkRun("queue_dequeue", 100000, TWMessageBarBenchmarkQueueFill, TWMessageBarBenchmarkQueueDequeue, TWMessageBarBenchmarkQueueTearDown);
+    
+    TWMessageBarBenchmarkRun("style_policy_resolve", 1000000, TWMessageBarBenchmarkPolicySetUp, TWMessageBarBenchmarkPolicyResolve, NULL);
+    TWMessageBarBenchmarkRun("text_layout_cache_hit", 1000000, TWMessageBarBenchmarkTextLayoutSetUp, TWMessageBarBenchmarkTextLayoutLookup, NULL);
+    TWMessageBarBenchmarkRun("text_layout_cache_miss", 1000000, TWMessageBarBenchmarkTextLayoutSetUp, TWMessageBarBenchmarkTextLayoutMiss, NULL);
+    
+    TWMessageBarBenchmarkRun("timer_reschedule", 1000000, TWMessageBarBenchmarkTimersVisibleSetUp, TWMessageBarBenchmarkTimersReschedule, TWMessageBarBenchmarkTimersTearDown);
+    TWMessageBarBenchmarkRun("timer_schedule_and_fire", 100000, NULL, TWMessageBarBenchmarkTimersScheduleAndFire, TWMessageBarBenchmarkTimersTearDown);
+    
+    TWMessageBarBenchmarkRun("layout_stack_vertical", 1000000, NULL, TWMessageBarBenchmarkStackLayoutVertical, NULL);
+    TWMessageBarBenchmarkRun("layout_stack_collapsed", 1000000, NULL, TWMessageBarBenchmarkStackLayoutCollapsed, NULL);
+    TWMessageBarBenchmarkRun("layout_spring_settle", 10000, NULL, TWMessageBarBenchmarkSpringSettle, NULL);
+    
+    TWMessageBarBenchmarkRun("histogram_record", 1000000, NULL, TWMessageBarBenchmarkHistogramRecord, NULL);
+    TWMessageBarBenchmarkRun("histogram_percentiles", 10000, TWMessageBarBenchmarkHistogramSetUp, TWMessageBarBenchmarkHistogramPercentiles, NULL);
+    
+    TWMessageBarBenchmarkRun("text_clamp_maximum", 100000, TWMessageBarBenchmarkTextSetUp, TWMessageBarBenchmarkTextClamp, TWMessageBarBenchmarkTextTearDown);
+    TWMessageBarBenchmarkRun("text_scan_title", 1000000, TWMessageBarBenchmarkTextSetUp, TWMessageBarBenchmarkTextScanTitle, TWMessageBarBenchmarkTextTearDown);
+    TWMessageBarBenchmarkRun("text_scan_maximum", 100000, TWMessageBarBenchmarkTextSetUp, TWMessageBarBenchmarkTextScanMaximum, TWMessageBarBenchmarkTextTearDown);
+    
+    TWMessageBarBenchmarkRun("blur_bar", 1000, TWMessageBarBenchmarkBlurBarSetUp, TWMessageBarBenchmarkBlur, TWMessageBarBenchmarkBlurTearDown);
+    TWMessageBarBenchmarkRun("blur_landscape_stack", 200, TWMessageBarBenchmarkBlurLandscapeSetUp, TWMessageBarBenchmarkBlur, TWMessageBarBenchmarkBlurTearDown);
+    TWMessageBarBenchmarkRun("blur_bar_scalar_reference", 100, TWMessageBarBenchmarkBlurBarSetUp, TWMessageBarBenchmarkBlurReference, TWMessageBarBenchmarkBlurTearDown);
+    TWMessageBarBenchmarkRun("blur_landscape_stack_scalar_reference", 20, TWMessageBarBenchmarkBlurLandscapeSetUp, TWMessageBarBenchmarkBlurReference, TWMessageBarBenchmarkBlurTearDown);
+    
+    printf("\n],\n\"drains\": [\n");
+    
+    TWMessageBarBenchmarkHandoffDrain("handoff_sequential", TWMessageBarHandoffModeSequential);
+    TWMessageBarBenchmarkHandoffDrain("handoff_cross_slide", TWMessageBarHandoffModeCrossSlide);
+    TWMessageBarBenchmarkHandoffDrain("handoff_cross_fade", TWMessageBarHandoffModeCrossFade);
+    
+    TWMessageBarBenchmarkStackDrain("stack_single", 1, 0);
+    TWMessageBarBenchmarkStackDrain("stack_vertical_3", 3, 0);
+    TWMessageBarBenchmarkStackDrain("stack_collapsed_3", 3, 1);
+    TWMessageBarBenchmarkStackDrain("stack_vertical_5", 5, 0);
+    
+    printf("\n]}\n");
+    return 0;
+}
@@ -0,0 +1,652 @@
+//
+//  TWMessageBarCore.c
+//
+//  Created by Terry Worona on 5/13/13.
+//  Copyright (c) 2013 Terry Worona. All rights reserved.
+//
+
+#include "TWMessageBarCore.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+// SIMD
+#if defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define TW_TEXT_SCAN_NEON 1
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define TW_TEXT_SCAN_SSE2 1
+#endif
+
+#define TW_MIN(a, b) ((a) < (b) ? (a) : (b))
+#define TW_MAX(a, b) ((a) > (b) ? (a) : (b))
+
+// Spring
+TWMessageBarSpring TWMessageBarSpringMake(double position, double velocity, double target, double settleDuration)
+{
+    double omega = TW_SPRING_SETTLE_CONSTANT / settleDuration;
+    TWMessageBarSpring spring = {position, velocity, target, omega * omega, 2.0 * omega};
+    return spring;
+}
+
+void TWMessageBarSpringStep(TWMessageBarSpring *spring, double interval)
+{
+    while (interval > 0.0)
+    {
+        double step = interval < TW_SPRING_STEP_INTERVAL ? interval : TW_SPRING_STEP_INTERVAL;
+        double acceleration = (-spring->stiffness * (spring->position - spring->target)) - (spring->damping * spring->velocity);
+        spring->velocity += acceleration * step;
+        spring->position += spring->velocity * step;
+        interval -= step;
+    }
+}
+
+int TWMessageBarSpringIsSettled(const TWMessageBarSpring *spring, double positionTolerance, double velocityTolerance)
+{
+    return fabs(spring->position - spring->target) < positionTolerance && fabs(spring->velocity) < velocityTolerance;
+}
+
+double TWMessageBarDecayProjectedPosition(double position, double velocity, double timeConstant)
+{
+    return position + (velocity * timeConstant);
+}
+
+// Stack layout
+void TWMessageBarStackLayout(const double *heights, double *offsets, size_t count, size_t index, double inset, double peek, int collapsed)
+{
+    for (size_t i = index; i < count; i++)
+    {
+        if (i == 0)
+        {
+            offsets[i] = 0.0;
+        }
+        else if (collapsed)
+        {
+            offsets[i] = heights[0] + (peek * (double)i) - heights[i];
+        }
+        else
+        {
+            offsets[i] = offsets[i - 1] + heights[i - 1] - inset;
+        }
+    }
+}
+
+// Histogram
+size_t TWMessageBarHistogramIndex(uint64_t value)
+{
+    if (value < (1 << TW_HISTOGRAM_SUB_BUCKET_BITS))
+    {
+        return (size_t)value;
+    }
+    unsigned int exponent = (unsigned int)(63 - __builtin_clzll(value)) - (TW_HISTOGRAM_SUB_BUCKET_BITS - 1);
+    return ((size_t)exponent * TW_HISTOGRAM_HALF_SUB_BUCKET_COUNT) + (size_t)(value >> exponent);
+}
+
+uint64_t TWMessageBarHistogramHighestEquivalentValue(size_t index)
+{
+    if (index < (1 << TW_HISTOGRAM_SUB_BUCKET_BITS))
+    {
+        return (uint64_t)index;
+    }
+    unsigned int exponent = (unsigned int)(index / TW_HISTOGRAM_HALF_SUB_BUCKET_COUNT) - 1;
+    uint64_t subBucket = (index % TW_HISTOGRAM_HALF_SUB_BUCKET_COUNT) + TW_HISTOGRAM_HALF_SUB_BUCKET_COUNT;
+    return ((subBucket + 1) << exponent) - 1;
+}
+
+void TWMessageBarHistogramRecord(TWMessageBarHistogram *histogram, uint64_t value)
+{
+    uint64_t limit = (1ULL << TW_HISTOGRAM_VALUE_BITS) - 1;
+    value = value < limit ? value : limit;
+    histogram->counts[TWMessageBarHistogramIndex(value)]++;
+    histogram->minimum = (histogram->totalCount == 0 || value < histogram->minimum) ? value : histogram->minimum;
+    histogram->maximum = value > histogram->maximum ? value : histogram->maximum;
+    histogram->sum += value;
+    histogram->totalCount++;
+}
+
+void TWMessageBarHistogramValuesAtPercentiles(const TWMessageBarHistogram *histogram, const double *percentiles, uint64_t *values, size_t count)
+{
+    size_t next = 0;
+    uint64_t seen = 0;
+    for (size_t index = 0; index < TW_HISTOGRAM_BUCKET_COUNT && next < count; index++)
+    {
+        seen += histogram->counts[index];
+        while (next < count && seen > 0 && (double)seen >= (percentiles[next] / 100.0) * (double)histogram->totalCount)
+        {
+            uint64_t value = TWMessageBarHistogramHighestEquivalentValue(index);
+            values[next++] = value < histogram->maximum ? value : histogram->maximum;
+        }
+    }
+    for (; next < count; next++)
+    {
+        values[next] = histogram->maximum;
+    }
+}
+
+// Text
+static size_t TWMessageBarTextClamp(const uint16_t *characters, size_t length, size_t maximumCharacters, size_t maximumLines, size_t *lineCount, size_t *unitsRead)
+{
+    size_t limit = length < maximumCharacters ? length : maximumCharacters;
+    size_t lines = 1;
+    for (size_t i = 0; i < limit; i++)
+    {
+        if (characters[i] == '\n' || characters[i] == 0x2028)
+        {
+            if (lines >= maximumLines)
+            {
+                *lineCount = lines;
+                *unitsRead = i + 1;
+                return i;
+            }
+            lines++;
+        }
+    }
+    *lineCount = lines;
+    *unitsRead = limit;
+    if (limit < length && limit > 0 && characters[limit - 1] >= 0xD800 && characters[limit - 1] <= 0xDBFF)
+    {
+        limit--; // high surrogate whose pair falls beyond the cut
+    }
+    return limit;
+}
+
+size_t TWMessageBarTextClampedLength(const uint16_t *characters, size_t length, size_t maximumCharacters, size_t maximumLines)
+{
+    size_t lineCount, unitsRead;
+    return TWMessageBarTextClamp(characters, length, maximumCharacters, maximumLines, &lineCount, &unitsRead);
+}
+
+TWMessageBarTextScan TWMessageBarTextScanCharacters(const uint16_t *characters, size_t length)
+{
+    size_t i = 0;
+    size_t newlineCount = 0;
+    uint16_t bits = 0;
+    int complex = 0;
+    
+#if defined(TW_TEXT_SCAN_NEON)
+    uint16x8_t orBits = vdupq_n_u16(0);
+    uint16x8_t complexBits = vdupq_n_u16(0);
+    for (; i + 8 <= length; i += 8)
+    {
+        uint16x8_t v = vld1q_u16(characters + i);
+        orBits = vorrq_u16(orBits, v);
+        newlineCount += vaddvq_u16(vshrq_n_u16(vceqq_u16(v, vdupq_n_u16('\n')), 15));
+        uint16x8_t combining = vcltq_u16(vsubq_u16(v, vdupq_n_u16(0x0300)), vdupq_n_u16(0x0070));
+        complexBits = vorrq_u16(complexBits, vorrq_u16(combining, vcgeq_u16(v, vdupq_n_u16(0x0590))));
+    }
+    bits = vmaxvq_u16(orBits); // below 0x80 exactly when the OR of every lane is
+    complex = vmaxvq_u16(complexBits) != 0;
+#elif defined(TW_TEXT_SCAN_SSE2)
+    __m128i orBits = _mm_setzero_si128();
+    __m128i complexBits = _mm_setzero_si128();
+    __m128i newlines = _mm_setzero_si128();
+    uint16_t lanes[8];
+    for (; i + 8 <= length; i += 8)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i *)(characters + i));
+        orBits = _mm_or_si128(orBits, v);
+        newlines = _mm_sub_epi16(newlines, _mm_cmpeq_epi16(v, _mm_set1_epi16('\n'))); // per-lane counts, flushed before they can wrap
+        if ((i & 0x3FFF8) == 0x3FFF8)
+        {
+            _mm_storeu_si128((__m128i *)lanes, newlines);
+            for (size_t lane = 0; lane < 8; lane++)
+            {
+                newlineCount += lanes[lane];
+            }
+            newlines = _mm_setzero_si128();
+        }
+        
+        // SSE2 has no unsigned 16-bit compare; saturating subtraction is non-zero exactly when the lane is above the bound
+        __m128i combining = _mm_cmpeq_epi16(_mm_subs_epu16(_mm_sub_epi16(v, _mm_set1_epi16(0x0300)), _mm_set1_epi16(0x006F)), _mm_setzero_si128());
+        complexBits = _mm_or_si128(complexBits, _mm_or_si128(combining, _mm_subs_epu16(v, _mm_set1_epi16(0x058F))));
+    }
+    _mm_storeu_si128((__m128i *)lanes, newlines);
+    for (size_t lane = 0; lane < 8; lane++)
+    {
+        newlineCount += lanes[lane];
+    }
+    _mm_storeu_si128((__m128i *)lanes, orBits);
+    for (size_t lane = 0; lane < 8; lane++)
+    {
+        bits |= lanes[lane];
+    }
+    complex = _mm_movemask_epi8(_mm_cmpeq_epi8(complexBits, _mm_setzero_si128())) != 0xFFFF;
+#endif
+    
+    for (; i < length; i++)
+    {
+        uint16_t character = characters[i];
+        bits |= character;
+        newlineCount += character == '\n';
+        complex |= (uint16_t)(character - 0x0300) < 0x0070 || character >= 0x0590;
+    }
+    
+    TWMessageBarTextScan scan = {newlineCount, bits < 0x0080, complex};
+    return scan;
+}
+
+TWMessageBarTextMeasurement TWMessageBarTextMeasure(const uint16_t *characters, size_t length, size_t maximumCharacters, size_t maximumLines)
+{
+    maximumCharacters = TW_MIN(maximumCharacters, TW_TEXT_MAXIMUM_CHARACTERS);
+    maximumLines = maximumLines > 0 ? TW_MIN(maximumLines, TW_TEXT_MAXIMUM_LINES) : 1;
+    
+    TWMessageBarTextMeasurement measurement;
+    measurement.length = TWMessageBarTextClamp(characters, length, maximumCharacters, maximumLines, &measurement.lineCount, &measurement.unitsRead);
+    measurement.lineCount = measurement.length > 0 ? measurement.lineCount : 0;
+    measurement.scan = TWMessageBarTextScanCharacters(characters, measurement.length); // within what the clamp read
+    return measurement;
+}
+
+double TWMessageBarTextMaximumHeight(double windowHeight, double heightRatio, double padding, double minimumHeight)
+{
+    return TW_MAX((windowHeight * heightRatio) - (padding * 2.0), minimumHeight);
+}
+
+double TWMessageBarTextBoundedHeight(size_t lineCount, double lineHeight, double maximumTextHeight)
+{
+    return TW_MIN(ceil((double)lineCount * lineHeight), maximumTextHeight);
+}
+
+// Message queue
+#define TW_QUEUE_MINIMUM_CAPACITY 16
+
+static inline TWMessageBarQueueEntry *TWMessageBarQueueEntryAtIndex(const TWMessageBarQueue *queue, size_t index)
+{
+    return &queue->entries[(queue->head + index) & (queue->capacity - 1)];
+}
+
+static int TWMessageBarQueueResize(TWMessageBarQueue *queue, size_t capacity)
+{
+    // Unwrapped into the new buffer, so the front is at index 0 again
+    TWMessageBarQueueEntry *entries = (TWMessageBarQueueEntry *)malloc(capacity * sizeof(TWMessageBarQueueEntry));
+    if (entries == NULL)
+    {
+        return 0;
+    }
+    for (size_t i = 0; i < queue->count; i++)
+    {
+        entries[i] = *TWMessageBarQueueEntryAtIndex(queue, i);
+    }
+    free(queue->entries);
+    queue->entries = entries;
+    queue->capacity = capacity;
+    queue->head = 0;
+    return 1;
+}
+
+static int TWMessageBarQueueReserve(TWMessageBarQueue *queue, size_t count)
+{
+    size_t capacity = queue->capacity > 0 ? queue->capacity : TW_QUEUE_MINIMUM_CAPACITY;
+    while (capacity < count)
+    {
+        capacity *= 2;
+    }
+    return capacity == queue->capacity || TWMessageBarQueueResize(queue, capacity);
+}
+
+int TWMessageBarQueueEnqueue(TWMessageBarQueue *queue, void *payload, long priority)
+{
+    if (!TWMessageBarQueueReserve(queue, queue->count + 1))
+    {
+        return 0;
+    }
+    
+    // With equal priorities (the common case) this is an append
+    size_t index = queue->count;
+    while (index > 0 && TWMessageBarQueueEntryAtIndex(queue, index - 1)->priority < priority)
+    {
+        *TWMessageBarQueueEntryAtIndex(queue, index) = *TWMessageBarQueueEntryAtIndex(queue, index - 1);
+        index--;
+    }
+    TWMessageBarQueueEntry *entry = TWMessageBarQueueEntryAtIndex(queue, index);
+    entry->payload = payload;
+    entry->priority = priority;
+    queue->count++;
+    return 1;
+}
+
+static void TWMessageBarQueueSortEntries(TWMessageBarQueueEntry *entries, TWMessageBarQueueEntry *scratch, size_t count)
+{
+    // Stable merge sort, descending priority
+    if (count < 2)
+    {
+        return;
+    }
+    size_t half = count / 2;
+    TWMessageBarQueueSortEntries(entries, scratch, half);
+    TWMessageBarQueueSortEntries(entries + half, scratch, count - half);
+    if (entries[half - 1].priority >= entries[half].priority)
+    {
+        return; // already in order, as batches of one type are
+    }
+    memcpy(scratch, entries, half * sizeof(TWMessageBarQueueEntry));
+    size_t left = 0, right = half, next = 0;
+    while (left < half && right < count)
+    {
+        entries[next++] = scratch[left].priority >= entries[right].priority ? scratch[left++] : entries[right++];
+    }
+    while (left < half)
+    {
+        entries[next++] = scratch[left++];
+    }
+}
+
+int TWMessageBarQueueEnqueueEntries(TWMessageBarQueue *queue, TWMessageBarQueueEntry *entries, size_t count)
+{
+    if (count == 0)
+    {
+        return 1;
+    }
+    
+    TWMessageBarQueueEntry *scratch = (TWMessageBarQueueEntry *)malloc((count / 2 + 1) * sizeof(TWMessageBarQueueEntry));
+    if (scratch == NULL || !TWMessageBarQueueReserve(queue, queue->count + count))
+    {
+        free(scratch);
+        return 0;
+    }
+    TWMessageBarQueueSortEntries(entries, scratch, count);
+    free(scratch);
+    
+    // Nothing jumps the line (the common case): a single append
+    size_t queueCount = queue->count;
+    if (queueCount == 0 || TWMessageBarQueueEntryAtIndex(queue, queueCount - 1)->priority >= entries[0].priority)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            *TWMessageBarQueueEntryAtIndex(queue, queueCount + i) = entries[i];
+        }
+        queue->count += count;
+        return 1;
+    }
+    
+    // Otherwise one merge from the back, so it runs in place
+    size_t queueIndex = queueCount, entryIndex = count, next = queueCount + count;
+    while (entryIndex > 0)
+    {
+        if (queueIndex > 0 && TWMessageBarQueueEntryAtIndex(queue, queueIndex - 1)->priority < entries[entryIndex - 1].priority)
+        {
+            *TWMessageBarQueueEntryAtIndex(queue, --next) = *TWMessageBarQueueEntryAtIndex(queue, --queueIndex);
+        }
+        else
+        {
+            *TWMessageBarQueueEntryAtIndex(queue, --next) = entries[--entryIndex];
+        }
+    }
+    queue->count += count;
+    return 1;
+}
+
+void *TWMessageBarQueueDequeue(TWMessageBarQueue *queue)
+{
+    if (queue->count == 0)
+    {
+        return NULL;
+    }
+    void *payload = queue->entries[queue->head].payload;
+    queue->head = (queue->head + 1) & (queue->capacity - 1);
+    queue->count--;
+    
+    // A drained burst gives its storage back
+    if (queue->capacity > TW_QUEUE_MINIMUM_CAPACITY && queue->count <= queue->capacity / 4)
+    {
+        TWMessageBarQueueResize(queue, queue->capacity / 2);
+    }
+    return payload;
+}
+
+void TWMessageBarQueueRemoveAll(TWMessageBarQueue *queue)
+{
+    free(queue->entries);
+    memset(queue, 0, sizeof(*queue));
+}
+
+// Timer queue
+static inline int TWMessageBarTimerPrecedes(const TWMessageBarTimer *timer1, const TWMessageBarTimer *timer2)
+{
+    return timer1->fireTime < timer2->fireTime || (timer1->fireTime == timer2->fireTime && timer1->sequence < timer2->sequence);
+}
+
+static void TWMessageBarTimerQueueSiftUp(TWMessageBarTimerQueue *queue, size_t index)
+{
+    TWMessageBarTimer timer = queue->timers[index];
+    while (index > 0 && TWMessageBarTimerPrecedes(&timer, &queue->timers[(index - 1) / 2]))
+    {
+        queue->timers[index] = queue->timers[(index - 1) / 2];
+        index = (index - 1) / 2;
+    }
+    queue->timers[index] = timer;
+}
+
+static void TWMessageBarTimerQueueSiftDown(TWMessageBarTimerQueue *queue, size_t index)
+{
+    TWMessageBarTimer timer = queue->timers[index];
+    for (;;)
+    {
+        size_t child = (index * 2) + 1;
+        if (child >= queue->count)
+        {
+            break;
+        }
+        if (child + 1 < queue->count && TWMessageBarTimerPrecedes(&queue->timers[child + 1], &queue->timers[child]))
+        {
+            child++;
+        }
+        if (!TWMessageBarTimerPrecedes(&queue->timers[child], &timer))
+        {
+            break;
+        }
+        queue->timers[index] = queue->timers[child];
+        index = child;
+    }
+    queue->timers[index] = timer;
+}
+
+static void TWMessageBarTimerQueueRemoveAtIndex(TWMessageBarTimerQueue *queue, size_t index)
+{
+    queue->count--;
+    if (index == queue->count)
+    {
+        return;
+    }
+    queue->timers[index] = queue->timers[queue->count];
+    TWMessageBarTimerQueueSiftUp(queue, index);
+    TWMessageBarTimerQueueSiftDown(queue, index);
+}
+
+int TWMessageBarTimerQueueSchedule(TWMessageBarTimerQueue *queue, double fireTime, void *payload)
+{
+    if (queue->count == queue->capacity)
+    {
+        size_t capacity = queue->capacity > 0 ? queue->capacity * 2 : TW_QUEUE_MINIMUM_CAPACITY;
+        TWMessageBarTimer *timers = (TWMessageBarTimer *)realloc(queue->timers, capacity * sizeof(TWMessageBarTimer));
+        if (timers == NULL)
+        {
+            return 0;
+        }
+        queue->timers = timers;
+        queue->capacity = capacity;
+    }
+    
+    TWMessageBarTimer *timer = &queue->timers[queue->count++];
+    timer->fireTime = fireTime;
+    timer->sequence = ++queue->lastSequence;
+    timer->payload = payload;
+    TWMessageBarTimerQueueSiftUp(queue, queue->count - 1);
+    return 1;
+}
+
+int TWMessageBarTimerQueueCancel(TWMessageBarTimerQueue *queue, const void *payload)
+{
+    for (size_t i = 0; i < queue->count; i++)
+    {
+        if (queue->timers[i].payload == payload)
+        {
+            TWMessageBarTimerQueueRemoveAtIndex(queue, i);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int TWMessageBarTimerQueuePopDue(TWMessageBarTimerQueue *queue, double time, TWMessageBarTimer *timer)
+{
+    if (queue->count == 0 || queue->timers[0].fireTime > time)
+    {
+        return 0;
+    }
+    *timer = queue->timers[0];
+    TWMessageBarTimerQueueRemoveAtIndex(queue, 0);
+    return 1;
+}
+
+void TWMessageBarTimerQueueRemoveAll(TWMessageBarTimerQueue *queue)
+{
+    uint64_t lastSequence = queue->lastSequence; // sequence numbers are never reused
+    free(queue->timers);
+    memset(queue, 0, sizeof(*queue));
+    queue->lastSequence = lastSequence;
+}
+
+// Hand-off
+TWMessageBarSlotRelease TWMessageBarSlotReleaseForDismissal(TWMessageBarHandoffMode mode, size_t maximumVisibleMessages, size_t queuedCount)
+{
+    if (maximumVisibleMessages > 1)
+    {
+        return TWMessageBarSlotReleaseOnDismissal;
+    }
+    if (mode == TWMessageBarHandoffModeSequential || queuedCount == 0)
+    {
+        return TWMessageBarSlotReleaseOnRemoval;
+    }
+    return mode == TWMessageBarHandoffModeCrossFade ? TWMessageBarSlotReleaseOnDismissalCrossFading : TWMessageBarSlotReleaseOnDismissal;
+}
+
+// Message policies
+TWMessageBarPolicyRecord TWMessageBarPolicyRecordCompile(TWMessageBarPolicyRecord policy, double defaultDuration)
+{
+    policy.duration = policy.duration > 0.0 ? policy.duration : defaultDuration;
+    policy.maximumNumberOfLines = TW_MIN(policy.maximumNumberOfLines, TW_TEXT_MAXIMUM_LINES);
+    return policy;
+}
+
+void TWMessageBarPolicyResolve(const TWMessageBarPolicyRecord *policy, TWMessageBarMessageOverrides overrides, TWMessageBarPresentation *presentation)
+{
+    presentation->duration = (overrides & TWMessageBarMessageOverrideDuration) ? presentation->duration : policy->duration;
+    presentation->statusBarStyle = (overrides & TWMessageBarMessageOverrideStatusBarStyle) ? presentation->statusBarStyle : policy->statusBarStyle;
+    presentation->statusBarHidden = (overrides & TWMessageBarMessageOverrideStatusBarHidden) ? presentation->statusBarHidden : policy->statusBarHidden;
+    presentation->priority = policy->priority;
+}
+
+// Text layouts
+const TWMessageBarTextLayout *TWMessageBarTextLayoutCacheLookup(const TWMessageBarTextLayoutCache *cache, double availableWidth, double maximumTextHeight)
+{
+    for (size_t i = 0; i < cache->count; i++)
+    {
+        if (cache->layouts[i].availableWidth == availableWidth && cache->layouts[i].maximumTextHeight == maximumTextHeight)
+        {
+            return &cache->layouts[i];
+        }
+    }
+    return NULL;
+}
+
+void TWMessageBarTextLayoutCacheInsert(TWMessageBarTextLayoutCache *cache, const TWMessageBarTextLayout *layout)
+{
+    if (cache->count == TW_TEXT_LAYOUT_CACHE_COUNT)
+    {
+        memmove(&cache->layouts[0], &cache->layouts[1], sizeof(TWMessageBarTextLayout) * (TW_TEXT_LAYOUT_CACHE_COUNT - 1));
+        cache->count--;
+    }
+    cache->layouts[cache->count++] = *layout;
+}
+
+// Blur
+/*
+ * Separable box blur over premultiplied RGBA8, written with GCC/Clang vector extensions so the same source
+ * compiles to NEON on devices and SSE on the simulator. Running sums are independent across a row, so both
+ * directions are blurred as columns (the horizontal one through a transpose), four pixels per vector step.
+ */
+typedef uint8_t TWMessageBarPixelBlock __attribute__((vector_size(16)));
+typedef uint16_t TWMessageBarPixelBlockSum __attribute__((vector_size(32)));
+typedef uint32_t TWMessageBarPixelBlockProduct __attribute__((vector_size(64)));
+
+static inline TWMessageBarPixelBlockSum TWMessageBarPixelBlockLoad(const uint8_t *pixels)
+{
+    TWMessageBarPixelBlock block;
+    memcpy(&block, pixels, sizeof(block));
+    return __builtin_convertvector(block, TWMessageBarPixelBlockSum);
+}
+
+static void TWMessageBarBoxBlurColumns(const uint8_t *source, uint8_t *destination, size_t width, size_t height, size_t bytesPerRow, size_t radius, TWMessageBarPixelBlockSum *sums)
+{
+    // Fixed-point divide by the window size; the result never exceeds 255
+    uint32_t reciprocal = (uint32_t)((65536 + radius) / (2 * radius + 1));
+    size_t blockCount = width / TW_BLUR_BLOCK_PIXELS;
+    size_t last = height - 1;
+    
+    // Edge rows repeat, so the window never reads outside the image
+    for (size_t x = 0; x < blockCount; x++)
+    {
+        sums[x] = TWMessageBarPixelBlockLoad(source + x * 16) * (uint16_t)(radius + 1);
+    }
+    for (size_t y = 1; y <= radius; y++)
+    {
+        const uint8_t *row = source + TW_MIN(y, last) * bytesPerRow;
+        for (size_t x = 0; x < blockCount; x++)
+        {
+            sums[x] += TWMessageBarPixelBlockLoad(row + x * 16);
+        }
+    }
+    
+    for (size_t y = 0; y < height; y++)
+    {
+        const uint8_t *entering = source + TW_MIN(y + radius + 1, last) * bytesPerRow;
+        const uint8_t *leaving = source + (y >= radius ? y - radius : 0) * bytesPerRow;
+        uint8_t *row = destination + y * bytesPerRow;
+        for (size_t x = 0; x < blockCount; x++)
+        {
+            TWMessageBarPixelBlock block = __builtin_convertvector((__builtin_convertvector(sums[x], TWMessageBarPixelBlockProduct) * reciprocal + (1 << 15)) >> 16, TWMessageBarPixelBlock);
+            memcpy(row + x * 16, &block, sizeof(block));
+            sums[x] += TWMessageBarPixelBlockLoad(entering + x * 16) - TWMessageBarPixelBlockLoad(leaving + x * 16); // wraps, but the sum stays exact
+        }
+    }
+}
+
+static void TWMessageBarTransposePixels(const uint8_t *source, uint8_t *destination, size_t width, size_t height)
+{
+    for (size_t y = 0; y < height; y++)
+    {
+        for (size_t x = 0; x < width; x++)
+        {
+            memcpy(destination + (x * height + y) * 4, source + (y * width + x) * 4, 4);
+        }
+    }
+}
+
+size_t TWMessageBarBoxBlurScratchSize(size_t width, size_t height)
+{
+    return (width * height * 4 * 2) + (TW_MAX(width, height) / TW_BLUR_BLOCK_PIXELS * sizeof(TWMessageBarPixelBlockSum));
+}
+
+void TWMessageBarBoxBlur(uint8_t *pixels, size_t width, size_t height, size_t radius, void *scratch)
+{
+    radius = TW_MIN(radius, TW_BLUR_MAXIMUM_RADIUS);
+    if (radius == 0 || width == 0 || height == 0 || width % TW_BLUR_BLOCK_PIXELS != 0 || height % TW_BLUR_BLOCK_PIXELS != 0)
+    {
+        return;
+    }
+    
+    TWMessageBarPixelBlockSum *sums = (TWMessageBarPixelBlockSum *)scratch;
+    uint8_t *blurred = (uint8_t *)scratch + (TW_MAX(width, height) / TW_BLUR_BLOCK_PIXELS * sizeof(TWMessageBarPixelBlockSum));
+    uint8_t *transposed = blurred + (width * height * 4);
+    for (int pass = 0; pass < TW_BLUR_PASSES; pass++)
+    {
+        TWMessageBarBoxBlurColumns(pixels, blurred, width, height, width * 4, radius, sums); // vertical
+        TWMessageBarTransposePixels(blurred, transposed, width, height);
+        TWMessageBarBoxBlurColumns(transposed, blurred, height, width, height * 4, radius, sums); // horizontal
+        TWMessageBarTransposePixels(blurred, pixels, height, width);
+    }
+}
+
@@ -0,0 +1,365 @@
+//
+//  TWMessageBarCore.h
+//
+//  Created by Terry Worona on 5/13/13.
+//  Copyright (c) 2013 Terry Worona. All rights reserved.
+//
+//  Plain C pieces of the manager with no UIKit dependencies, so they can be built, tested
+//  and benchmarked on any platform.
+//
+
+#ifndef TWMessageBarCore_h
+#define TWMessageBarCore_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Spring
+
+#define TW_SPRING_STEP_INTERVAL (1.0 / 240.0)
+#define TW_SPRING_SETTLE_CONSTANT 8.0
+
+typedef struct {
+    double position;
+    double velocity;
+    double target;
+    double stiffness;
+    double damping;
+} TWMessageBarSpring;
+
+/**
+ *  Critically damped spring (unit mass) that comes within ~0.3% of its target after settleDuration.
+ */
+TWMessageBarSpring TWMessageBarSpringMake(double position, double velocity, double target, double settleDuration);
+
+/**
+ *  Advances the spring by interval seconds. Semi-implicit Euler in fixed sub-steps keeps it stable at any frame rate.
+ */
+void TWMessageBarSpringStep(TWMessageBarSpring *spring, double interval);
+
+/**
+ *  @return Non-zero once both the distance to the target and the speed are within their tolerances.
+ */
+int TWMessageBarSpringIsSettled(const TWMessageBarSpring *spring, double positionTolerance, double velocityTolerance);
+
+/**
+ *  Resting position of a body released with the given velocity under exponential decay (time constant in seconds).
+ */
+double TWMessageBarDecayProjectedPosition(double position, double velocity, double timeConstant);
+
+// Stack Layout
+
+/**
+ *  Resting offsets for a stack of bars. Offsets before `index` are kept; the rest are recomputed from the
+ *  cached heights alone. Vertical stacks tuck each bar's status bar inset under the bar above it;
+ *  collapsed stacks align each card's bottom edge behind the first bar, peeking out a little further each time.
+ */
+void TWMessageBarStackLayout(const double *heights, double *offsets, size_t count, size_t index, double inset, double peek, int collapsed);
+
+// Histogram
+
+#define TW_HISTOGRAM_SUB_BUCKET_BITS 5
+#define TW_HISTOGRAM_VALUE_BITS 40
+#define TW_HISTOGRAM_HALF_SUB_BUCKET_COUNT (1 << (TW_HISTOGRAM_SUB_BUCKET_BITS - 1))
+#define TW_HISTOGRAM_BUCKET_COUNT ((TW_HISTOGRAM_VALUE_BITS - TW_HISTOGRAM_SUB_BUCKET_BITS + 2) * TW_HISTOGRAM_HALF_SUB_BUCKET_COUNT)
+
+/**
+ *  Log-linear (HDR) histogram over [0, 2^40). Values below 2^5 are exact; above that each power of two
+ *  is split into 16 sub-buckets, bounding the relative error at 1/16. Storage is fixed; recording never allocates.
+ *  A zeroed struct is an empty histogram.
+ */
+typedef struct {
+    uint64_t counts[TW_HISTOGRAM_BUCKET_COUNT];
+    uint64_t totalCount;
+    uint64_t minimum;
+    uint64_t maximum;
+    uint64_t sum;
+} TWMessageBarHistogram;
+
+size_t TWMessageBarHistogramIndex(uint64_t value);
+uint64_t TWMessageBarHistogramHighestEquivalentValue(size_t index);
+
+/**
+ *  Records one value; anything at or above 2^40 is clamped into the last bucket.
+ */
+void TWMessageBarHistogramRecord(TWMessageBarHistogram *histogram, uint64_t value);
+
+/**
+ *  Fills values[i] with the value at percentiles[i] (ascending, 0-100) in a single pass over the buckets.
+ */
+void TWMessageBarHistogramValuesAtPercentiles(const TWMessageBarHistogram *histogram, const double *percentiles, uint64_t *values, size_t count);
+
+// Text
+
+#define TW_TEXT_MAXIMUM_CHARACTERS 1024
+#define TW_TEXT_MAXIMUM_LINES 32
+
+/**
+ *  Length (in UTF-16 units) of the prefix of `characters` that keeps within both caps: at most maximumCharacters units
+ *  and at most maximumLines lines, cut before the newline that would start the next one. Never splits a surrogate pair.
+ *  Reads at most maximumCharacters units, so the cost is bounded by the caps rather than the input length.
+ */
+size_t TWMessageBarTextClampedLength(const uint16_t *characters, size_t length, size_t maximumCharacters, size_t maximumLines);
+
+/**
+ *  One pass classification of UTF-16 text ahead of measurement. "Complex" text needs the full text system regardless:
+ *  combining marks (U+0300-U+036F) and everything from Hebrew (U+0590) up, which covers RTL, Indic and CJK scripts,
+ *  emoji and all surrogates. Latin, Greek and Cyrillic without combining marks are simple.
+ */
+typedef struct {
+    size_t newlineCount;
+    int asciiOnly;
+    int complex;
+} TWMessageBarTextScan;
+
+/**
+ *  Scans with NEON on arm64, SSE2 on x86 and plain C elsewhere; every path gives the same result.
+ */
+TWMessageBarTextScan TWMessageBarTextScanCharacters(const uint16_t *characters, size_t length);
+
+/**
+ *  What the manager knows about a title or description before the text system sees it.
+ */
+typedef struct {
+    size_t length; // units kept (TWMessageBarTextClampedLength)
+    size_t lineCount; // lines in the kept text, 0 when it's empty
+    size_t unitsRead; // input units examined
+    TWMessageBarTextScan scan; // of the kept text
+} TWMessageBarTextMeasurement;
+
+/**
+ *  Clamps and scans in one go. The caps are bounded by TW_TEXT_MAXIMUM_CHARACTERS and TW_TEXT_MAXIMUM_LINES (a zero line
+ *  cap means one line), so no more than TW_TEXT_MAXIMUM_CHARACTERS units are read whatever the input length.
+ */
+TWMessageBarTextMeasurement TWMessageBarTextMeasure(const uint16_t *characters, size_t length, size_t maximumCharacters, size_t maximumLines);
+
+/**
+ *  Height the text of one bar may take in a window: heightRatio of the window less the padding above and below,
+ *  but never less than minimumHeight.
+ */
+double TWMessageBarTextMaximumHeight(double windowHeight, double heightRatio, double padding, double minimumHeight);
+
+/**
+ *  Height of lineCount lines, rounded up to whole points and capped at maximumTextHeight.
+ */
+double TWMessageBarTextBoundedHeight(size_t lineCount, double lineHeight, double maximumTextHeight);
+
+// Message Queue
+
+/**
+ *  Queued message and the priority it was queued with. The payload is opaque to the queue.
+ */
+typedef struct {
+    void *payload;
+    long priority;
+} TWMessageBarQueueEntry;
+
+/**
+ *  Messages waiting for a slot on screen, in descending priority and first in, first out within a priority.
+ *  A ring buffer, so presenting from the front is O(1) and the common equal-priority enqueue is an append.
+ *  A zeroed struct is an empty queue.
+ */
+typedef struct {
+    TWMessageBarQueueEntry *entries;
+    size_t capacity; // 0 or a power of two
+    size_t head;
+    size_t count;
+} TWMessageBarQueue;
+
+/**
+ *  @return Zero if the queue couldn't grow; the payload was not queued.
+ */
+int TWMessageBarQueueEnqueue(TWMessageBarQueue *queue, void *payload, long priority);
+
+/**
+ *  Queues a batch with a single stable sort and at most one merge; queued messages stay ahead of new ones with the same
+ *  priority. Reorders `entries` in place.
+ *
+ *  @return Zero if the queue couldn't grow; nothing was queued.
+ */
+int TWMessageBarQueueEnqueueEntries(TWMessageBarQueue *queue, TWMessageBarQueueEntry *entries, size_t count);
+
+/**
+ *  @return The payload at the front of the queue, or NULL when empty.
+ */
+void *TWMessageBarQueueDequeue(TWMessageBarQueue *queue);
+
+static inline void *TWMessageBarQueuePayloadAtIndex(const TWMessageBarQueue *queue, size_t index)
+{
+    return queue->entries[(queue->head + index) & (queue->capacity - 1)].payload;
+}
+
+/**
+ *  Empties the queue and frees its storage. Payloads are the caller's to release beforehand.
+ */
+void TWMessageBarQueueRemoveAll(TWMessageBarQueue *queue);
+
+// Timer Queue
+
+typedef struct {
+    double fireTime;
+    uint64_t sequence;
+    void *payload;
+} TWMessageBarTimer;
+
+/**
+ *  Pending timers as a binary min-heap on fire time, then scheduling order, so timers due at the same time fire
+ *  first in, first out. Cancelling searches the heap; it holds a handful of timers (one per bar on screen,
+ *  an announcement and an animation frame). A zeroed struct is an empty queue.
+ */
+typedef struct {
+    TWMessageBarTimer *timers;
+    size_t capacity;
+    size_t count;
+    uint64_t lastSequence;
+} TWMessageBarTimerQueue;
+
+/**
+ *  Schedules `payload`, which identifies the timer from then on and must not already be scheduled.
+ *
+ *  @return Zero if the queue couldn't grow; nothing was scheduled.
+ */
+int TWMessageBarTimerQueueSchedule(TWMessageBarTimerQueue *queue, double fireTime, void *payload);
+
+/**
+ *  @return Zero if no timer with this payload is pending (it already fired, was cancelled or belongs to another queue).
+ */
+int TWMessageBarTimerQueueCancel(TWMessageBarTimerQueue *queue, const void *payload);
+
+/**
+ *  Removes the earliest timer into `timer` if it is due at or before `time`.
+ *
+ *  @return Non-zero if a timer was removed.
+ */
+int TWMessageBarTimerQueuePopDue(TWMessageBarTimerQueue *queue, double time, TWMessageBarTimer *timer);
+
+/**
+ *  Empties the queue and frees its storage. Payloads are the caller's to release beforehand.
+ */
+void TWMessageBarTimerQueueRemoveAll(TWMessageBarTimerQueue *queue);
+
+// Hand-off
+
+/**
+ *  Mirrors the public TWMessageBarHandoffStyle.
+ */
+typedef enum {
+    TWMessageBarHandoffModeSequential = 0,
+    TWMessageBarHandoffModeCrossSlide,
+    TWMessageBarHandoffModeCrossFade
+} TWMessageBarHandoffMode;
+
+/**
+ *  When a dismissed bar gives up its slot to the next queued message.
+ */
+typedef enum {
+    TWMessageBarSlotReleaseOnRemoval = 0, // once the bar has left the screen
+    TWMessageBarSlotReleaseOnDismissal, // as the dismissal starts; the next bar slides in alongside it
+    TWMessageBarSlotReleaseOnDismissalCrossFading // as the dismissal starts; the bars fade across in place
+} TWMessageBarSlotRelease;
+
+/**
+ *  Stacks always release right away; a single bar hands off early only when something is queued to take its place.
+ */
+TWMessageBarSlotRelease TWMessageBarSlotReleaseForDismissal(TWMessageBarHandoffMode mode, size_t maximumVisibleMessages, size_t queuedCount);
+
+// Message Policies
+
+/**
+ *  Show call arguments that take precedence over the message policy.
+ */
+typedef enum {
+    TWMessageBarMessageOverrideNone = 0,
+    TWMessageBarMessageOverrideDuration = 1 << 0,
+    TWMessageBarMessageOverrideStatusBarHidden = 1 << 1,
+    TWMessageBarMessageOverrideStatusBarStyle = 1 << 2
+} TWMessageBarMessageOverrides;
+
+/**
+ *  Compiled presentation defaults for one message type (mirrors the public TWMessageBarMessagePolicy).
+ */
+typedef struct {
+    double duration;
+    long priority;
+    int coalesces;
+    size_t maximumNumberOfLines; // 0 for no cap (up to TW_TEXT_MAXIMUM_LINES)
+    int statusBarHidden;
+    long statusBarStyle;
+} TWMessageBarPolicyRecord;
+
+/**
+ *  Per-message values resolved from the show call and the type's policy.
+ */
+typedef struct {
+    double duration;
+    long priority;
+    int statusBarHidden;
+    long statusBarStyle;
+} TWMessageBarPresentation;
+
+/**
+ *  Resolves defaults up front so presentation reads the record as is: a zero duration becomes defaultDuration,
+ *  and the line cap is clamped to TW_TEXT_MAXIMUM_LINES. A zero line cap stays zero, meaning no cap beyond that bound.
+ */
+TWMessageBarPolicyRecord TWMessageBarPolicyRecordCompile(TWMessageBarPolicyRecord policy, double defaultDuration);
+
+/**
+ *  Fills every value of `presentation` not named in `overrides` from the policy.
+ */
+void TWMessageBarPolicyResolve(const TWMessageBarPolicyRecord *policy, TWMessageBarMessageOverrides overrides, TWMessageBarPresentation *presentation);
+
+// Text Layouts
+
+#define TW_TEXT_LAYOUT_CACHE_COUNT 4
+
+/**
+ *  Measured text for one window geometry. Keyed by the two inputs that depend on it, so a stale entry can never match.
+ */
+typedef struct {
+    double availableWidth;
+    double maximumTextHeight;
+    double titleWidth;
+    double titleHeight;
+    double descriptionWidth;
+    double descriptionHeight;
+} TWMessageBarTextLayout;
+
+/**
+ *  The last few layouts of one bar; the oldest entry makes room once every slot is taken. A zeroed struct is empty.
+ */
+typedef struct {
+    TWMessageBarTextLayout layouts[TW_TEXT_LAYOUT_CACHE_COUNT];
+    size_t count;
+} TWMessageBarTextLayoutCache;
+
+/**
+ *  @return The layout measured for exactly this geometry, or NULL.
+ */
+const TWMessageBarTextLayout *TWMessageBarTextLayoutCacheLookup(const TWMessageBarTextLayoutCache *cache, double availableWidth, double maximumTextHeight);
+
+void TWMessageBarTextLayoutCacheInsert(TWMessageBarTextLayoutCache *cache, const TWMessageBarTextLayout *layout);
+
+// Blur
+
+#define TW_BLUR_MAXIMUM_RADIUS 32 // pixels, after downsampling; keeps every window sum within 16 bits
+#define TW_BLUR_PASSES 3 // three box passes approximate a Gaussian
+#define TW_BLUR_BLOCK_PIXELS 4 // bitmap dimensions are rounded up to whole blocks
+
+size_t TWMessageBarBoxBlurScratchSize(size_t width, size_t height);
+
+/**
+ *  Blurs tightly packed premultiplied RGBA8 pixels in place. Both dimensions must be multiples of TW_BLUR_BLOCK_PIXELS,
+ *  and scratch must hold TWMessageBarBoxBlurScratchSize() bytes at 32-byte alignment. Radii past TW_BLUR_MAXIMUM_RADIUS
+ *  are clamped.
+ */
+void TWMessageBarBoxBlur(uint8_t *pixels, size_t width, size_t height, size_t radius, void *scratch);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
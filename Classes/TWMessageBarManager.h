@@ -10,6 +10,8 @@
 
 /**
  *  Three base message bar types. Their look & feel is defined within the MessageBarStyleSheet.
+ *  Additional types can be registered at runtime (see registerMessageTypeWithName:backgroundColor:strokeColor:iconImage:);
+ *  they are assigned dense IDs following TWMessageBarMessageTypeInfo.
  */
 typedef NS_ENUM(NSInteger, TWMessageBarMessageType) {
     TWMessageBarMessageTypeError,
@@ -17,6 +19,171 @@ typedef NS_ENUM(NSInteger, TWMessageBarMessageType) {
     TWMessageBarMessageTypeInfo
 };
 
+/**
+ *  Presentation defaults for a message type (see TWMessageBarManager -setPolicy:forMessageType:).
+ *  A duration, status bar style or status bar visibility passed to a show call takes precedence.
+ */
+typedef struct {
+    CGFloat duration;                   // display duration in seconds; 0 uses the default duration
+    NSInteger priority;                 // queued ahead of messages with a lower priority (first in, first out within a priority)
+    BOOL coalesces;                     // a message with the type & title of one queued or on screen updates it instead of queueing
+    NSUInteger maximumNumberOfLines;    // caps the title and the description each; 0 leaves it to the style sheet
+    BOOL statusBarHidden;
+    UIStatusBarStyle statusBarStyle;
+} TWMessageBarMessagePolicy;
+
+/**
+ *  How the manager hands off from one message to the next queued message.
+ */
+typedef NS_ENUM(NSInteger, TWMessageBarHandoffStyle) {
+    TWMessageBarHandoffStyleSequential, // the next message slides in once the previous one is gone
+    TWMessageBarHandoffStyleCrossSlide, // the next message slides in while the previous one slides out
+    TWMessageBarHandoffStyleCrossFade   // the next message fades in while the previous one fades out
+};
+
+/**
+ *  Arrangement of visible messages when more than one can be presented at a time.
+ */
+typedef NS_ENUM(NSInteger, TWMessageBarStackStyle) {
+    TWMessageBarStackStyleVertical, // messages are laid out one below the other
+    TWMessageBarStackStyleCollapsed // later messages are tucked behind the first one as a card stack
+};
+
+/**
+ *  Lifecycle intervals reported to trace sinks. Each one is reported as a begin/end pair.
+ */
+typedef NS_ENUM(NSInteger, TWMessageBarTraceEvent) {
+    TWMessageBarTraceEventEnqueue,  // a show call adding the message to the queue
+    TWMessageBarTraceEventLayout,   // measuring the message view
+    TWMessageBarTraceEventDraw,     // drawing the message view
+    TWMessageBarTraceEventSlideIn,  // presentation animation
+    TWMessageBarTraceEventVisible,  // resting on screen
+    TWMessageBarTraceEventSlideOut, // dismissal animation
+    TWMessageBarTraceEventCallback, // running the tap callback
+    TWMessageBarTraceEventCoalesce  // merging a message into one already queued
+};
+
+typedef NS_ENUM(NSInteger, TWMessageBarTracePhase) {
+    TWMessageBarTracePhaseBegin,
+    TWMessageBarTracePhaseEnd
+};
+
+/**
+ *  Trace sink invoked on the main thread for every lifecycle event.
+ *
+ *  @param event                The lifecycle interval.
+ *  @param phase                Begin or end of the interval.
+ *  @param messageIdentifier    Non-zero identifier shared by all events of a single message.
+ *  @param timestamp            Monotonic time in nanoseconds.
+ *  @param context              The context pointer supplied with the callback.
+ */
+typedef void (*TWMessageBarTraceCallback)(TWMessageBarTraceEvent event, TWMessageBarTracePhase phase, uint64_t messageIdentifier, uint64_t timestamp, void * _Nullable context);
+
+/**
+ *  Installs (or, when NULL, removes) the trace sink. Independently of the sink, lifecycle events are emitted
+ *  as os_signpost intervals (iOS 12+) whenever Instruments is recording the "com.terryworona.TWMessageBarManager" subsystem.
+ *  With neither attached, tracing costs a pointer compare per event.
+ *
+ *  @param callback     Trace sink, or NULL to disable.
+ *  @param context      Opaque pointer handed back to the sink.
+ */
+FOUNDATION_EXPORT void TWMessageBarSetTraceCallback(TWMessageBarTraceCallback _Nullable callback, void * _Nullable context);
+
+/**
+ *  Starts or stops recording lifecycle events into a fixed in-memory ring buffer holding the most recent 4096 events.
+ *  Recording is lock-free and never allocates; the buffer may be exported from any thread while recording continues.
+ *
+ *  @param enabled  YES to record, NO to stop (already recorded events are kept until the next start).
+ */
+FOUNDATION_EXPORT void TWMessageBarSetTraceRecordingEnabled(BOOL enabled);
+
+/**
+ *  Streams the recorded events as Chrome trace-event JSON, loadable in Perfetto or chrome://tracing.
+ *  Events are written in small chunks; the document is never built in memory.
+ *
+ *  @param stream   An opened output stream.
+ *  @param error    Set to the stream error when a write fails.
+ *
+ *  @return YES if the whole document was written.
+ */
+FOUNDATION_EXPORT BOOL TWMessageBarWriteTraceEvents(NSOutputStream * _Nonnull stream, NSError * _Nullable * _Nullable error);
+
+/**
+ *  Distribution summary of a metrics histogram. Durations are in microseconds; percentiles are accurate to within 1/16.
+ */
+typedef struct {
+    uint64_t count;
+    uint64_t minimum;
+    uint64_t p50;
+    uint64_t p90;
+    uint64_t p99;
+    uint64_t maximum;
+    double mean;
+} TWMessageBarHistogramSummary;
+
+/**
+ *  Snapshot of the manager's counters and histograms (see TWMessageBarManager -metrics).
+ */
+typedef struct {
+    NSUInteger enqueuedCount;   // messages submitted
+    NSUInteger presentedCount;  // messages that reached the screen
+    NSUInteger tappedCount;     // dismissed by a tap
+    NSUInteger swipedCount;     // dismissed by a swipe
+    NSUInteger timedOutCount;   // dismissed when their duration elapsed
+    NSUInteger discardedCount;  // dropped by hideAll (queued or on screen)
+    NSUInteger coalescedCount;  // merged into a message already queued or on screen (included in enqueuedCount)
+    TWMessageBarHistogramSummary timeInQueue;       // enqueue until presentation starts
+    TWMessageBarHistogramSummary timeToVisible;     // enqueue until the bar comes to rest on screen
+    TWMessageBarHistogramSummary visibleDuration;   // at rest on screen until dismissal starts
+    TWMessageBarHistogramSummary queueDepth;        // queued messages at the time of each enqueue (a count, not a duration)
+    NSUInteger backingStoreBytes;   // estimated pixel memory held by bars on screen right now (not reset)
+} TWMessageBarMetrics;
+
+/**
+ *  Time source and scheduler behind display timers, bar animations and metrics. All calls happen on the main thread.
+ */
+@protocol TWMessageBarClock <NSObject>
+
+/**
+ *  @return Monotonic time in seconds.
+ */
+- (NSTimeInterval)currentTime;
+
+/**
+ *  Runs a block once the given delay has elapsed.
+ *
+ *  @param block    The block to run.
+ *  @param delay    Delay in seconds.
+ *
+ *  @return Token identifying the scheduled block.
+ */
+- (nonnull id)scheduleBlock:(nonnull void (^)(void))block afterDelay:(NSTimeInterval)delay;
+
+/**
+ *  Cancels a block that hasn't run yet.
+ *
+ *  @param token    A token returned by scheduleBlock:afterDelay:.
+ */
+- (void)cancelScheduledBlock:(nonnull id)token;
+
+@end
+
+/**
+ *  Clock that only moves when told to. Assigned to a manager, it turns display timers and bar animations into
+ *  a deterministic simulation: an hour of traffic replays as fast as the scheduled work itself runs.
+ *  Fade animations (fade hand-offs and animated hideAll) remain UIKit animations in real time.
+ */
+@interface TWMessageBarVirtualClock : NSObject <TWMessageBarClock>
+
+/**
+ *  Moves time forward, running every block that falls due, in order, at its scheduled time.
+ *
+ *  @param interval Seconds to advance.
+ */
+- (void)advanceBy:(NSTimeInterval)interval;
+
+@end
+
 @protocol TWMessageBarStyleSheet <NSObject>
 
 /**
@@ -92,6 +259,128 @@ typedef NS_ENUM(NSInteger, TWMessageBarMessageType) {
  */
 - (nonnull UIColor *)descriptionColorForMessageType:(TWMessageBarMessageType)type;
 
+/**
+ *  The (optional) maximum number of lines for the message's title; longer titles are truncated with an ellipsis.
+ *
+ *  Default: 0 (as many lines as fit in half the screen)
+ *
+ *  @param type A MessageBarMessageType (error, information, success, etc).
+ *
+ *  @return Maximum number of lines, or 0 for no limit.
+ */
+- (NSUInteger)titleMaximumNumberOfLinesForMessageType:(TWMessageBarMessageType)type;
+
+/**
+ *  The (optional) maximum number of lines for the message's description; longer descriptions are truncated with an ellipsis.
+ *
+ *  Default: 0 (as many lines as fit in half the screen)
+ *
+ *  @param type A MessageBarMessageType (error, information, success, etc).
+ *
+ *  @return Maximum number of lines, or 0 for no limit.
+ */
+- (NSUInteger)descriptionMaximumNumberOfLinesForMessageType:(TWMessageBarMessageType)type;
+
+/**
+ *  The (optional) maximum number of characters (UTF-16 units) kept from the message's title. Text beyond it is dropped before measuring.
+ *
+ *  Default: 0 (1024)
+ *
+ *  @param type A MessageBarMessageType (error, information, success, etc).
+ *
+ *  @return Maximum number of characters, or 0 for the default. Values above 1024 are capped.
+ */
+- (NSUInteger)titleMaximumLengthForMessageType:(TWMessageBarMessageType)type;
+
+/**
+ *  The (optional) maximum number of characters (UTF-16 units) kept from the message's description. Text beyond it is dropped before measuring.
+ *
+ *  Default: 0 (1024)
+ *
+ *  @param type A MessageBarMessageType (error, information, success, etc).
+ *
+ *  @return Maximum number of characters, or 0 for the default. Values above 1024 are capped.
+ */
+- (NSUInteger)descriptionMaximumLengthForMessageType:(TWMessageBarMessageType)type;
+
+/**
+ *  The (optional) flag indicating the message's background fills every pixel of the bar.
+ *  Opaque bars are composited without blending over the content beneath them, which is cheaper during animations.
+ *
+ *  Default: YES if the background color's alpha is 1.0, NO otherwise
+ *
+ *  @param type A MessageBarMessageType (error, information, success, etc).
+ *
+ *  @return YES if the message bar is opaque.
+ */
+- (BOOL)isOpaqueForMessageType:(TWMessageBarMessageType)type;
+
+/**
+ *  The (optional) blur radius, in points, applied to the content behind the message bar.
+ *  The content is captured once when the bar is presented and shows through the background color's translucency.
+ *
+ *  Default: 0 (no blur)
+ *
+ *  @param type A MessageBarMessageType (error, information, success, etc).
+ *
+ *  @return Blur radius in points, or 0 for none.
+ */
+- (CGFloat)backgroundBlurRadiusForMessageType:(TWMessageBarMessageType)type;
+
+@end
+
+/**
+ *  Describes a single message for batch submission (see TWMessageBarManager -showMessages:).
+ *  Duration, status bar style and status bar visibility are taken from the message type's policy unless they are set.
+ */
+@interface TWMessageBarMessage : NSObject <NSCopying>
+
+/**
+ *  Convenience constructor.
+ *
+ *  @param title        Header text in the message view.
+ *  @param description  Description text in the message view.
+ *  @param type         Type dictates color, stroke and icon shown in the message view.
+ *
+ *  @return A message descriptor.
+ */
++ (nonnull instancetype)messageWithTitle:(nullable NSString *)title description:(nullable NSString *)description type:(TWMessageBarMessageType)type;
+
+/**
+ *  Header text in the message view.
+ */
+@property (nullable, nonatomic, copy) NSString *title;
+
+/**
+ *  Description text in the message view.
+ */
+@property (nullable, nonatomic, copy) NSString *messageDescription;
+
+/**
+ *  Type dictates color, stroke and icon shown in the message view.
+ */
+@property (nonatomic, assign) TWMessageBarMessageType type;
+
+/**
+ *  Seconds on screen before the message is dismissed. Setting it overrides the message type's policy.
+ */
+@property (nonatomic, assign) CGFloat duration;
+
+/**
+ *  Status bar style while the message is shown. Setting it overrides the message type's policy.
+ */
+@property (nonatomic, assign) UIStatusBarStyle statusBarStyle;
+
+/**
+ *  Hides the status bar while the message is shown. Setting it overrides the message type's policy.
+ */
+@property (nonatomic, assign) BOOL statusBarHidden;
+
+/**
+ *  Callback block to be executed if the message is tapped; not called if it times out, is swiped away or is hidden.
+ */
+@property (nullable, nonatomic, copy) void (^callback)();
+
 @end
 
 @interface TWMessageBarManager : NSObject
@@ -111,6 +400,36 @@ typedef NS_ENUM(NSInteger, TWMessageBarMessageType) {
  */
 + (CGFloat)defaultDuration;
 
+/**
+ *  The default style sheet with fully opaque background colors.
+ *  Assign it to styleSheet to trade the translucent look for cheaper compositing.
+ *
+ *  @return Style sheet instance.
+ */
++ (nonnull NSObject<TWMessageBarStyleSheet> *)opaqueDefaultStyleSheet;
+
+/**
+ *  Registers a custom message type styled by the default style sheet. Must be called on the main thread.
+ *  Registering a name twice returns the original type; at most 64 types (including the three built-ins) are supported.
+ *
+ *  @param name             Unique name, also used in accessibility announcements (e.g. "warning").
+ *  @param backgroundColor  Background color of the message bar.
+ *  @param strokeColor      Color of the bottom stroke.
+ *  @param iconImage        Icon shown to the left of the text.
+ *
+ *  @return The new message type, usable anywhere a TWMessageBarMessageType is accepted.
+ */
++ (TWMessageBarMessageType)registerMessageTypeWithName:(nonnull NSString *)name backgroundColor:(nonnull UIColor *)backgroundColor strokeColor:(nonnull UIColor *)strokeColor iconImage:(nonnull UIImage *)iconImage;
+
+/**
+ *  Name of a built-in or registered message type.
+ *
+ *  @param messageType A MessageBarMessageType.
+ *
+ *  @return The registered name, or nil if the type is unknown.
+ */
++ (nullable NSString *)nameForMessageType:(TWMessageBarMessageType)messageType;
+
 /**
  *  Flag indicating if message is currently visible on screen.
  */
@@ -130,6 +449,73 @@ typedef NS_ENUM(NSInteger, TWMessageBarMessageType) {
  */
 @property (nonnull, nonatomic, strong) NSObject<TWMessageBarStyleSheet> *styleSheet;
 
+/**
+ *  Transition used between consecutive queued messages.
+ *  Overlapping hand-offs remove the dead time between bars and raise throughput when a backlog builds up.
+ *
+ *  Default: TWMessageBarHandoffStyleSequential
+ */
+@property (nonatomic, assign) TWMessageBarHandoffStyle handoffStyle;
+
+/**
+ *  The maximum number of messages visible at once. Values greater than 1 present queued messages as a stack;
+ *  when a message is dismissed the remaining ones slide into place and the next queued message fills the free slot.
+ *
+ *  Default: 1
+ */
+@property (nonatomic, assign) NSUInteger maximumVisibleMessages;
+
+/**
+ *  Arrangement of the visible messages when maximumVisibleMessages is greater than 1.
+ *
+ *  Default: TWMessageBarStackStyleVertical
+ */
+@property (nonatomic, assign) TWMessageBarStackStyle stackStyle;
+
+/**
+ *  Instrumentation hook: the number of text attribute bundles (fonts, colors & paragraph style) built so far.
+ *  Bundles are cached per message type and shared by all message views; they are only rebuilt after a new style sheet is assigned.
+ *  To pick up style sheet values that change at runtime, re-assign the style sheet.
+ */
+@property (nonatomic, readonly) NSUInteger styleAttributesAllocationCount;
+
+/**
+ *  Snapshot of queue latency, depth and dismissal metrics collected since launch (or the last reset).
+ *  Recording is allocation-free; taking a snapshot walks a few fixed-size histograms.
+ */
+@property (nonatomic, readonly) TWMessageBarMetrics metrics;
+
+/**
+ *  Time source for display timers, bar animations and metrics. Defaults to the system clock (display link driven animations);
+ *  set a TWMessageBarVirtualClock to simulate. Setting nil restores the system clock. Visible messages keep the rest of
+ *  their display time across a change; metrics timestamps taken on the previous clock are not comparable.
+ */
+@property (null_resettable, nonatomic, strong) id<TWMessageBarClock> clock;
+
+/**
+ *  Clears all metrics counters and histograms.
+ */
+- (void)resetMetrics;
+
+/**
+ *  Presentation defaults for a message type. Every type starts out with the default duration, priority 0,
+ *  no coalescing, no line cap and a visible status bar in UIStatusBarStyleDefault.
+ *
+ *  @param messageType A MessageBarMessageType.
+ *
+ *  @return The policy in effect (normalized, e.g. a 0 duration is reported as the default duration).
+ */
+- (TWMessageBarMessagePolicy)policyForMessageType:(TWMessageBarMessageType)messageType;
+
+/**
+ *  Replaces the presentation defaults of a built-in or registered message type. Applies to messages shown afterwards;
+ *  configure once (e.g. at launch) rather than per message.
+ *
+ *  @param policy       The new policy.
+ *  @param messageType  A MessageBarMessageType.
+ */
+- (void)setPolicy:(TWMessageBarMessagePolicy)policy forMessageType:(TWMessageBarMessageType)messageType;
+
 /**
  *  Shows a message with the supplied title, description and type.
  *
@@ -216,6 +602,15 @@ typedef NS_ENUM(NSInteger, TWMessageBarMessageType) {
  */
 - (void)showMessageWithTitle:(nullable NSString *)title description:(nullable NSString *)description type:(TWMessageBarMessageType)type duration:(CGFloat)duration statusBarHidden:(BOOL)statusBarHidden callback:(nullable void (^)())callback;
 
+/**
+ *  Shows a batch of messages, as if each were shown in turn, but resolved, measured and queued in a single pass
+ *  with presentation started at most once. May be called from any thread: the descriptors are copied before
+ *  returning and queued on the main thread.
+ *
+ *  @param messages     TWMessageBarMessage descriptors, in presentation order (within a priority).
+ */
+- (void)showMessages:(nonnull NSArray *)messages;
+
 /**
  *  Hides the topmost message and removes all remaining messages in the queue.
  *
@@ -7,9 +7,21 @@
 
 #import "TWMessageBarManager.h"
 
+// Core
+#import "TWMessageBarCore.h"
+
 // Quartz
 #import <QuartzCore/QuartzCore.h>
 
+// Atomics
+#import <stdatomic.h>
+
+// Signposts
+#if __has_include(<os/signpost.h>)
+#import <os/signpost.h>
+#define TW_SIGNPOSTS_AVAILABLE 1
+#endif
+
 // Numerics (TWMessageBarStyleSheet)
 CGFloat const kTWMessageBarStyleSheetMessageBarAlpha = 0.96f;
 
@@ -18,40 +30,483 @@ CGFloat const kTWMessageViewBarPadding = 10.0f;
 CGFloat const kTWMessageViewIconSize = 36.0f;
 CGFloat const kTWMessageViewTextOffset = 2.0f;
 NSUInteger const kTWMessageViewiOS7Identifier = 7;
+NSInteger const kTWMessageViewTraceEventNone = -1;
+CGFloat const kTWMessageViewMaximumHeightRatio = 0.5f; // of the window height, below the status bar
+CGFloat const kTWMessageViewBlurDownsampling = 4.0f; // points per snapshot pixel
 
 // Numerics (TWMessageBarManager)
 CGFloat const kTWMessageBarManagerDisplayDelay = 3.0f;
 CGFloat const kTWMessageBarManagerDismissAnimationDuration = 0.25f;
-CGFloat const kTWMessageBarManagerPanVelocity = 0.2f;
-CGFloat const kTWMessageBarManagerPanAnimationDuration = 0.0002f;
+CGFloat const kTWMessageBarManagerPanDecayTimeConstant = 0.2f; // seconds; a released bar coasts velocity x this
+CGFloat const kTWMessageBarManagerStackCardPeek = 6.0f;
+NSTimeInterval const kTWMessageBarManagerAnnouncementCoalescingInterval = 0.3;
+NSTimeInterval const kTWMessageBarManagerAnnouncementMinimumInterval = 1.0;
+
+// Numerics (TWMessageBarGlyphAdvanceTable)
+CGFloat const kTWMessageBarGlyphAdvanceTableKerningTolerance = 0.01f;
+
+// Numerics (TWMessageBarAnimator)
+CGFloat const kTWMessageBarAnimatorPositionTolerance = 0.5f;
+CGFloat const kTWMessageBarAnimatorVelocityTolerance = 10.0f;
+CFTimeInterval const kTWMessageBarAnimatorMaximumFrameInterval = 1.0 / 30.0;
+CFTimeInterval const kTWMessageBarAnimatorClockFrameInterval = 1.0 / 60.0;
 
 // Strings (TWMessageBarStyleSheet)
 NSString * const kTWMessageBarStyleSheetImageIconError = @"icon-error.png";
 NSString * const kTWMessageBarStyleSheetImageIconSuccess = @"icon-success.png";
 NSString * const kTWMessageBarStyleSheetImageIconInfo = @"icon-info.png";
 
-// Fonts (TWMessageView)
+// Strings (TWMessageBarManager)
+NSString * const kTWMessageBarMessageTypeNameError = @"error";
+NSString * const kTWMessageBarMessageTypeNameSuccess = @"success";
+NSString * const kTWMessageBarMessageTypeNameInfo = @"info";
+NSString * const kTWMessageBarManagerAnnouncementErrorFormat = @"%lu error";
+NSString * const kTWMessageBarManagerAnnouncementErrorsFormat = @"%lu errors";
+NSString * const kTWMessageBarManagerAnnouncementSuccessFormat = @"%lu success";
+NSString * const kTWMessageBarManagerAnnouncementSuccessesFormat = @"%lu successes";
+NSString * const kTWMessageBarManagerAnnouncementInfoFormat = @"%lu info message";
+NSString * const kTWMessageBarManagerAnnouncementInfosFormat = @"%lu info messages";
+NSString * const kTWMessageBarManagerAnnouncementCustomFormat = @"%lu %@"; // count, registered type name
+
+// Fonts (TWMessageBarStyleAttributes)
 static UIFont *kTWMessageViewTitleFont = nil;
 static UIFont *kTWMessageViewDescriptionFont = nil;
 
-// Colors (TWMessageView)
+// Colors (TWMessageBarStyleAttributes)
 static UIColor *kTWMessageViewTitleColor = nil;
 static UIColor *kTWMessageViewDescriptionColor = nil;
 
-// Colors (TWDefaultMessageBarStyleSheet)
-static UIColor *kTWDefaultMessageBarStyleSheetErrorBackgroundColor = nil;
-static UIColor *kTWDefaultMessageBarStyleSheetSuccessBackgroundColor = nil;
-static UIColor *kTWDefaultMessageBarStyleSheetInfoBackgroundColor = nil;
-static UIColor *kTWDefaultMessageBarStyleSheetErrorStrokeColor = nil;
-static UIColor *kTWDefaultMessageBarStyleSheetSuccessStrokeColor = nil;
-static UIColor *kTWDefaultMessageBarStyleSheetInfoStrokeColor = nil;
+// Paragraph styles (TWMessageBarStyleAttributes)
+static NSParagraphStyle *kTWMessageViewParagraphStyle = nil;
+
+// Instrumentation (TWMessageBarStyleAttributes)
+static NSUInteger kTWMessageBarStyleAttributesAllocationCount = 0;
+
+// Advance tables (TWMessageBarGlyphAdvanceTable)
+static NSMutableDictionary *kTWMessageBarGlyphAdvanceTables = nil; // keyed by font
+
+// Tracing (TWMessageBarManager)
+static TWMessageBarTraceCallback kTWMessageBarTraceCallback = NULL;
+static void *kTWMessageBarTraceContext = NULL;
+static uint64_t kTWMessageBarManagerMessageIdentifier = 0;
+
+// Message types (TWMessageBarManager); IDs are dense, so every per-type table is a flat array indexed by type
+#define TW_MESSAGE_TYPE_CAPACITY 64
+static NSUInteger kTWMessageBarMessageTypeCount = 0;
+static NSString *kTWMessageBarMessageTypeNames[TW_MESSAGE_TYPE_CAPACITY];
+
+// Colors & images (TWDefaultMessageBarStyleSheet), indexed by message type
+static UIColor *kTWDefaultMessageBarStyleSheetBackgroundColors[TW_MESSAGE_TYPE_CAPACITY];
+static UIColor *kTWDefaultMessageBarStyleSheetOpaqueBackgroundColors[TW_MESSAGE_TYPE_CAPACITY];
+static UIColor *kTWDefaultMessageBarStyleSheetStrokeColors[TW_MESSAGE_TYPE_CAPACITY];
+static UIImage *kTWDefaultMessageBarStyleSheetIconImages[TW_MESSAGE_TYPE_CAPACITY];
+
+// Tracing
+#ifdef TW_SIGNPOSTS_AVAILABLE
+
+#define TW_SIGNPOST_INTERVAL(log, signpostID, phase, name) \
+    do { \
+        if ((phase) == TWMessageBarTracePhaseBegin) { os_signpost_interval_begin(log, signpostID, name); } \
+        else { os_signpost_interval_end(log, signpostID, name); } \
+    } while (0)
+
+static os_log_t TWMessageBarTraceLog(void) API_AVAILABLE(ios(12.0))
+{
+    static os_log_t log = nil;
+    static dispatch_once_t pred;
+    dispatch_once(&pred, ^{
+        log = os_log_create("com.terryworona.TWMessageBarManager", "Lifecycle");
+    });
+    return log;
+}
+
+static void TWMessageBarTraceSignpost(os_log_t log, TWMessageBarTraceEvent event, TWMessageBarTracePhase phase, uint64_t messageIdentifier) API_AVAILABLE(ios(12.0))
+{
+    os_signpost_id_t signpostID = (os_signpost_id_t)messageIdentifier;
+    switch (event)
+    {
+        case TWMessageBarTraceEventEnqueue:
+            TW_SIGNPOST_INTERVAL(log, signpostID, phase, "Enqueue");
+            break;
+        case TWMessageBarTraceEventLayout:
+            TW_SIGNPOST_INTERVAL(log, signpostID, phase, "Layout");
+            break;
+        case TWMessageBarTraceEventDraw:
+            TW_SIGNPOST_INTERVAL(log, signpostID, phase, "Draw");
+            break;
+        case TWMessageBarTraceEventSlideIn:
+            TW_SIGNPOST_INTERVAL(log, signpostID, phase, "Slide In");
+            break;
+        case TWMessageBarTraceEventVisible:
+            TW_SIGNPOST_INTERVAL(log, signpostID, phase, "Visible");
+            break;
+        case TWMessageBarTraceEventSlideOut:
+            TW_SIGNPOST_INTERVAL(log, signpostID, phase, "Slide Out");
+            break;
+        case TWMessageBarTraceEventCallback:
+            TW_SIGNPOST_INTERVAL(log, signpostID, phase, "Callback");
+            break;
+        case TWMessageBarTraceEventCoalesce:
+            TW_SIGNPOST_INTERVAL(log, signpostID, phase, "Coalesce");
+            break;
+    }
+}
+
+#endif
+
+static uint64_t TWMessageBarTraceTimestamp(void)
+{
+    return (uint64_t)(CACurrentMediaTime() * NSEC_PER_SEC);
+}
+
+// Trace recording
+#define TW_TRACE_RING_CAPACITY 4096
+#define TW_TRACE_EXPORT_CHUNK_SIZE 4096
+
+/*
+ * Slots are guarded by a per-slot sequence (a seqlock): odd while being written, 2n + 2 once event n is complete.
+ * Payload fields are relaxed atomics so a reader racing the single writer sees a torn slot, never undefined behaviour.
+ */
+typedef struct {
+    _Atomic uint64_t sequence;
+    _Atomic uint64_t timestamp;
+    _Atomic uint64_t messageIdentifier;
+    _Atomic uint32_t eventAndPhase;
+} TWMessageBarTraceSlot;
+
+static TWMessageBarTraceSlot kTWMessageBarTraceRing[TW_TRACE_RING_CAPACITY];
+static _Atomic uint64_t kTWMessageBarTraceRingHead = 0;
+static _Atomic int kTWMessageBarTraceRecording = 0;
+
+/*
+ * Single producer (trace events are emitted on the main thread).
+ */
+static void TWMessageBarTraceRecord(TWMessageBarTraceEvent event, TWMessageBarTracePhase phase, uint64_t messageIdentifier, uint64_t timestamp)
+{
+    uint64_t head = atomic_load_explicit(&kTWMessageBarTraceRingHead, memory_order_relaxed);
+    TWMessageBarTraceSlot *slot = &kTWMessageBarTraceRing[head & (TW_TRACE_RING_CAPACITY - 1)];
+    
+    atomic_store_explicit(&slot->sequence, (2 * head) + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    atomic_store_explicit(&slot->timestamp, timestamp, memory_order_relaxed);
+    atomic_store_explicit(&slot->messageIdentifier, messageIdentifier, memory_order_relaxed);
+    atomic_store_explicit(&slot->eventAndPhase, ((uint32_t)event << 1) | (uint32_t)phase, memory_order_relaxed);
+    atomic_store_explicit(&slot->sequence, (2 * head) + 2, memory_order_release);
+    atomic_store_explicit(&kTWMessageBarTraceRingHead, head + 1, memory_order_release);
+}
+
+/*
+ * Copies event n out of the ring; fails if it has been (or is being) overwritten.
+ */
+static BOOL TWMessageBarTraceRecordRead(uint64_t n, uint64_t *timestamp, uint64_t *messageIdentifier, uint32_t *eventAndPhase)
+{
+    TWMessageBarTraceSlot *slot = &kTWMessageBarTraceRing[n & (TW_TRACE_RING_CAPACITY - 1)];
+    uint64_t sequence = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+    if (sequence != (2 * n) + 2)
+    {
+        return NO;
+    }
+    *timestamp = atomic_load_explicit(&slot->timestamp, memory_order_relaxed);
+    *messageIdentifier = atomic_load_explicit(&slot->messageIdentifier, memory_order_relaxed);
+    *eventAndPhase = atomic_load_explicit(&slot->eventAndPhase, memory_order_relaxed);
+    atomic_thread_fence(memory_order_acquire);
+    return atomic_load_explicit(&slot->sequence, memory_order_relaxed) == sequence;
+}
+
+static const char *TWMessageBarTraceEventName(uint32_t event)
+{
+    static const char *names[] = {"Enqueue", "Layout", "Draw", "Slide In", "Visible", "Slide Out", "Callback", "Coalesce"};
+    return event < sizeof(names) / sizeof(names[0]) ? names[event] : "Unknown";
+}
+
+static BOOL TWMessageBarTraceWrite(NSOutputStream *stream, const uint8_t *bytes, size_t length)
+{
+    while (length > 0)
+    {
+        NSInteger written = [stream write:bytes maxLength:length];
+        if (written <= 0)
+        {
+            return NO;
+        }
+        bytes += written;
+        length -= (size_t)written;
+    }
+    return YES;
+}
+
+/*
+ * Costs a pointer compare, a relaxed load (and a signpost-enabled check on iOS 12+) when nobody is listening.
+ */
+static inline void TWMessageBarTrace(TWMessageBarTraceEvent event, TWMessageBarTracePhase phase, uint64_t messageIdentifier)
+{
+    TWMessageBarTraceCallback callback = kTWMessageBarTraceCallback;
+    BOOL recording = atomic_load_explicit(&kTWMessageBarTraceRecording, memory_order_relaxed);
+    if (callback != NULL || recording)
+    {
+        // One reading for both, so the sink and the ring agree on when it happened
+        uint64_t timestamp = TWMessageBarTraceTimestamp();
+        if (callback != NULL)
+        {
+            callback(event, phase, messageIdentifier, timestamp, kTWMessageBarTraceContext);
+        }
+        if (recording)
+        {
+            TWMessageBarTraceRecord(event, phase, messageIdentifier, timestamp);
+        }
+    }
+#ifdef TW_SIGNPOSTS_AVAILABLE
+    if (@available(iOS 12.0, *))
+    {
+        os_log_t log = TWMessageBarTraceLog();
+        if (os_signpost_enabled(log))
+        {
+            TWMessageBarTraceSignpost(log, event, phase, messageIdentifier);
+        }
+    }
+#endif
+}
+
+void TWMessageBarSetTraceCallback(TWMessageBarTraceCallback callback, void *context)
+{
+    kTWMessageBarTraceContext = context;
+    kTWMessageBarTraceCallback = callback;
+}
+
+void TWMessageBarSetTraceRecordingEnabled(BOOL enabled)
+{
+    if (enabled && !atomic_load_explicit(&kTWMessageBarTraceRecording, memory_order_relaxed))
+    {
+        // Old events stay readable until they are overwritten; skipping a lap of sequence numbers invalidates them for readers
+        uint64_t head = atomic_load_explicit(&kTWMessageBarTraceRingHead, memory_order_relaxed);
+        atomic_store_explicit(&kTWMessageBarTraceRingHead, head + TW_TRACE_RING_CAPACITY, memory_order_release);
+    }
+    atomic_store_explicit(&kTWMessageBarTraceRecording, enabled ? 1 : 0, memory_order_relaxed);
+}
+
+BOOL TWMessageBarWriteTraceEvents(NSOutputStream *stream, NSError **error)
+{
+    uint8_t chunk[TW_TRACE_EXPORT_CHUNK_SIZE];
+    size_t length = 0;
+    BOOL succeeded = YES;
+    
+    uint64_t head = atomic_load_explicit(&kTWMessageBarTraceRingHead, memory_order_acquire);
+    uint64_t tail = head > TW_TRACE_RING_CAPACITY ? head - TW_TRACE_RING_CAPACITY : 0;
+    BOOL first = YES;
+    
+    length += (size_t)snprintf((char *)chunk, sizeof(chunk), "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+    for (uint64_t n = tail; n < head && succeeded; n++)
+    {
+        uint64_t timestamp, messageIdentifier;
+        uint32_t eventAndPhase;
+        if (!TWMessageBarTraceRecordRead(n, &timestamp, &messageIdentifier, &eventAndPhase))
+        {
+            continue;
+        }
+        
+        // Async events keyed by message identifier, so overlapping messages don't have to nest
+        int written = snprintf((char *)chunk + length, sizeof(chunk) - length,
+                               "%s\n{\"name\":\"%s\",\"cat\":\"TWMessageBar\",\"ph\":\"%c\",\"id\":\"0x%llx\",\"ts\":%llu.%03llu,\"pid\":1,\"tid\":1}",
+                               first ? "" : ",",
+                               TWMessageBarTraceEventName(eventAndPhase >> 1),
+                               (eventAndPhase & 1) == TWMessageBarTracePhaseBegin ? 'b' : 'e',
+                               (unsigned long long)messageIdentifier,
+                               (unsigned long long)(timestamp / 1000), (unsigned long long)(timestamp % 1000));
+        first = NO;
+        length += (size_t)written;
+        
+        // Flush with room to spare for the next event
+        if (length > sizeof(chunk) - 256)
+        {
+            succeeded = TWMessageBarTraceWrite(stream, chunk, length);
+            length = 0;
+        }
+    }
+    
+    if (succeeded)
+    {
+        length += (size_t)snprintf((char *)chunk + length, sizeof(chunk) - length, "\n]}\n");
+        succeeded = TWMessageBarTraceWrite(stream, chunk, length);
+    }
+    if (!succeeded && error != NULL)
+    {
+        *error = stream.streamError;
+    }
+    return succeeded;
+}
+
+// Metrics
+static TWMessageBarHistogramSummary TWMessageBarHistogramSummarize(const TWMessageBarHistogram *histogram)
+{
+    static const double percentiles[3] = {50.0, 90.0, 99.0};
+    uint64_t values[3] = {0, 0, 0};
+    TWMessageBarHistogramValuesAtPercentiles(histogram, percentiles, values, 3);
+    
+    TWMessageBarHistogramSummary summary;
+    summary.count = histogram->totalCount;
+    summary.minimum = histogram->minimum;
+    summary.p50 = values[0];
+    summary.p90 = values[1];
+    summary.p99 = values[2];
+    summary.maximum = histogram->maximum;
+    summary.mean = histogram->totalCount > 0 ? (double)histogram->sum / (double)histogram->totalCount : 0.0;
+    return summary;
+}
+
+// Glyph advances (TWMessageBarGlyphAdvanceTable); printable ASCII only
+#define TW_ADVANCE_TABLE_FIRST_CHARACTER 0x20
+#define TW_ADVANCE_TABLE_COUNT 95
+
+typedef enum {
+    TWMessageBarKerningPairUnknown = 0,
+    TWMessageBarKerningPairPlain,
+    TWMessageBarKerningPairKerned
+} TWMessageBarKerningPairState;
+
+// Message type registry (TWMessageBarManager); main thread only
+static TWMessageBarMessageType TWMessageBarMessageTypeRegister(NSString *name, UIColor *backgroundColor, UIColor *strokeColor, UIImage *iconImage)
+{
+    for (NSUInteger type = 0; type < kTWMessageBarMessageTypeCount; type++)
+    {
+        if ([kTWMessageBarMessageTypeNames[type] isEqualToString:name])
+        {
+            return (TWMessageBarMessageType)type;
+        }
+    }
+    if (kTWMessageBarMessageTypeCount == TW_MESSAGE_TYPE_CAPACITY)
+    {
+        [NSException raise:NSRangeException format:@"At most %d message types can be registered", TW_MESSAGE_TYPE_CAPACITY];
+    }
+    
+    NSUInteger type = kTWMessageBarMessageTypeCount++;
+    kTWMessageBarMessageTypeNames[type] = [name copy];
+    kTWDefaultMessageBarStyleSheetBackgroundColors[type] = backgroundColor;
+    kTWDefaultMessageBarStyleSheetOpaqueBackgroundColors[type] = [backgroundColor colorWithAlphaComponent:1.0f];
+    kTWDefaultMessageBarStyleSheetStrokeColors[type] = strokeColor;
+    kTWDefaultMessageBarStyleSheetIconImages[type] = iconImage;
+    return (TWMessageBarMessageType)type;
+}
+
+static void TWMessageBarMessageTypesInitialize(void)
+{
+    static dispatch_once_t once;
+    dispatch_once(&once, ^{
+        // Registered in enum order, so the built-in values index their own slots
+        TWMessageBarMessageTypeRegister(kTWMessageBarMessageTypeNameError, [UIColor colorWithRed:1.0 green:0.611 blue:0.0 alpha:kTWMessageBarStyleSheetMessageBarAlpha], [UIColor colorWithRed:0.949f green:0.580f blue:0.0f alpha:1.0f], [UIImage imageNamed:kTWMessageBarStyleSheetImageIconError]); // orange
+        TWMessageBarMessageTypeRegister(kTWMessageBarMessageTypeNameSuccess, [UIColor colorWithRed:0.0f green:0.831f blue:0.176f alpha:kTWMessageBarStyleSheetMessageBarAlpha], [UIColor colorWithRed:0.0f green:0.772f blue:0.164f alpha:1.0f], [UIImage imageNamed:kTWMessageBarStyleSheetImageIconSuccess]); // green
+        TWMessageBarMessageTypeRegister(kTWMessageBarMessageTypeNameInfo, [UIColor colorWithRed:0.0 green:0.482 blue:1.0 alpha:kTWMessageBarStyleSheetMessageBarAlpha], [UIColor colorWithRed:0.0f green:0.415f blue:0.803f alpha:1.0f], [UIImage imageNamed:kTWMessageBarStyleSheetImageIconInfo]); // blue
+    });
+}
+
+static inline BOOL TWMessageBarMessageTypeIsRegistered(TWMessageBarMessageType type)
+{
+    return type >= 0 && (NSUInteger)type < kTWMessageBarMessageTypeCount;
+}
+
+static inline NSUInteger TWMessageBarMessageTypeIndex(TWMessageBarMessageType type)
+{
+    // Unregistered values fall back to info rather than reading past the tables
+    return TWMessageBarMessageTypeIsRegistered(type) ? (NSUInteger)type : (NSUInteger)TWMessageBarMessageTypeInfo;
+}
+
+// Message policies (TWMessageBarManager)
+static TWMessageBarPolicyRecord TWMessageBarPolicyRecordDefault(void)
+{
+    TWMessageBarPolicyRecord policy;
+    memset(&policy, 0, sizeof(policy));
+    policy.duration = kTWMessageBarManagerDisplayDelay;
+    policy.statusBarStyle = UIStatusBarStyleDefault;
+    return policy;
+}
+
+static TWMessageBarPolicyRecord TWMessageBarPolicyRecordFromPolicy(TWMessageBarMessagePolicy policy)
+{
+    TWMessageBarPolicyRecord record;
+    record.duration = policy.duration;
+    record.priority = policy.priority;
+    record.coalesces = policy.coalesces;
+    record.maximumNumberOfLines = policy.maximumNumberOfLines;
+    record.statusBarHidden = policy.statusBarHidden;
+    record.statusBarStyle = policy.statusBarStyle;
+    return TWMessageBarPolicyRecordCompile(record, kTWMessageBarManagerDisplayDelay);
+}
+
+static TWMessageBarMessagePolicy TWMessageBarPolicyFromPolicyRecord(const TWMessageBarPolicyRecord *record)
+{
+    TWMessageBarMessagePolicy policy;
+    policy.duration = (CGFloat)record->duration;
+    policy.priority = (NSInteger)record->priority;
+    policy.coalesces = record->coalesces ? YES : NO;
+    policy.maximumNumberOfLines = record->maximumNumberOfLines;
+    policy.statusBarHidden = record->statusBarHidden ? YES : NO;
+    policy.statusBarStyle = (UIStatusBarStyle)record->statusBarStyle;
+    return policy;
+}
+
+// Backing stores (TWMessageView)
+static BOOL TWMessageViewChoosesBackingStoreFormat(void)
+{
+    // From iOS 12, UIKit sizes drawRect: backing stores to what was drawn (8-bit alpha for single-color text)
+    NSProcessInfo *processInfo = [NSProcessInfo processInfo];
+    return [processInfo respondsToSelector:@selector(isOperatingSystemAtLeastVersion:)] && [processInfo isOperatingSystemAtLeastVersion:(NSOperatingSystemVersion){12, 0, 0}];
+}
+
+// Background blur (TWMessageView)
+static void TWMessageBarReleasePixels(void *info, const void *data, size_t size)
+{
+    free((void *)data);
+}
 
 @protocol TWMessageViewDelegate;
 
+@interface TWMessageBarStyleAttributes : NSObject
+
+@property (nonatomic, strong, readonly) UIFont *titleFont;
+@property (nonatomic, strong, readonly) UIFont *descriptionFont;
+@property (nonatomic, strong, readonly) UIColor *titleColor;
+@property (nonatomic, strong, readonly) UIColor *descriptionColor;
+@property (nonatomic, copy, readonly) NSDictionary *titleAttributes;
+@property (nonatomic, copy, readonly) NSDictionary *descriptionAttributes;
+@property (nonatomic, assign, readonly) NSUInteger titleMaximumNumberOfLines;
+@property (nonatomic, assign, readonly) NSUInteger descriptionMaximumNumberOfLines;
+@property (nonatomic, assign, readonly) NSUInteger titleMaximumLength;
+@property (nonatomic, assign, readonly) NSUInteger descriptionMaximumLength;
+@property (nonatomic, strong, readonly) UIColor *backgroundColor;
+@property (nonatomic, strong, readonly) UIColor *strokeColor;
+@property (nonatomic, strong, readonly) UIImage *iconImage;
+@property (nonatomic, assign, readonly, getter = isOpaque) BOOL opaque;
+@property (nonatomic, assign, readonly) CGFloat backgroundBlurRadius;
+
+// Initializers
+- (id)initWithStyleSheet:(NSObject<TWMessageBarStyleSheet> *)styleSheet type:(TWMessageBarMessageType)type maximumNumberOfLines:(NSUInteger)maximumNumberOfLines;
+
+@end
+
+@interface TWMessageBarMessage ()
+
+@property (nonatomic, assign) TWMessageBarMessageOverrides overrides; // values set explicitly; the rest come from the policy
+@property (nonatomic, assign) NSInteger priority;
+@property (nonatomic, assign) uint64_t identifier;
+@property (nonatomic, assign) uint64_t enqueueTimestamp;
+
+// Text clamped ahead of presentation
+@property (nonatomic, copy) NSString *clampedTitle;
+@property (nonatomic, copy) NSString *clampedDescription;
+@property (nonatomic, assign) TWMessageBarTextScan titleScan;
+@property (nonatomic, assign) TWMessageBarTextScan descriptionScan;
+@property (nonatomic, assign, getter = isClamped) BOOL clamped;
+
+@end
+
 @interface TWMessageView : UIView
+{
+    TWMessageBarTextLayoutCache _textLayouts; // portrait, landscape and any split-view widths seen
+}
 
 @property (nonatomic, copy) NSString *titleString;
 @property (nonatomic, copy) NSString *descriptionString;
+@property (nonatomic, copy) NSString *sourceTitle; // unclamped; matched when coalescing
+@property (nonatomic, assign) TWMessageBarTextScan titleScan;
+@property (nonatomic, assign) TWMessageBarTextScan descriptionScan;
 
 @property (nonatomic, assign) TWMessageBarMessageType messageType;
 
@@ -59,8 +514,26 @@ static UIColor *kTWDefaultMessageBarStyleSheetInfoStrokeColor = nil;
 @property (nonatomic, strong) NSArray *callbacks;
 
 @property (nonatomic, assign, getter = isHit) BOOL hit;
+@property (nonatomic, assign, getter = isDiscarded) BOOL discarded; // taken over by hideAll
 
 @property (nonatomic, assign) CGFloat duration;
+@property (nonatomic, assign) CGFloat restingOffset; // vertical offset within the stack
+@property (nonatomic, assign, getter = isTracking) BOOL tracking; // following a pan
+
+@property (nonatomic, assign) uint64_t messageIdentifier;
+@property (nonatomic, assign) NSInteger traceEvent; // lifecycle interval currently open
+
+@property (nonatomic, assign) uint64_t enqueueTimestamp;
+@property (nonatomic, assign) uint64_t visibleTimestamp;
+@property (nonatomic, assign) uint64_t dismissTimestamp;
+
+@property (nonatomic, strong) id dismissTimer; // TWMessageBarClock token
+@property (nonatomic, assign) NSTimeInterval dismissTime; // clock time the dismiss timer fires at
+
+@property (nonatomic, strong) UIImage *backgroundImage; // blurred snapshot of the content beneath
+@property (nonatomic, strong) CALayer *strokeLayer;
+@property (nonatomic, strong) CALayer *iconLayer;
+@property (nonatomic, assign, getter = isBackingStoreReleased) BOOL backingStoreReleased;
 
 @property (nonatomic, assign) UIStatusBarStyle statusBarStyle;
 @property (nonatomic, assign) BOOL statusBarHidden;
@@ -70,6 +543,18 @@ static UIColor *kTWDefaultMessageBarStyleSheetInfoStrokeColor = nil;
 // Initializers
 - (id)initWithTitle:(NSString *)title description:(NSString *)description type:(TWMessageBarMessageType)type;
 
+// Text
++ (NSString *)clampedString:(NSString *)string maximumCharacters:(NSUInteger)maximumCharacters maximumLines:(NSUInteger)maximumLines scan:(TWMessageBarTextScan *)scan;
+- (void)updateTitle:(NSString *)title description:(NSString *)description;
+
+// Background
+- (void)captureBackground;
+
+// Backing store
+- (void)releaseBackingStore;
+- (void)restoreBackingStore;
+- (NSUInteger)backingStoreBytes;
+
 // Getters
 - (CGFloat)height;
 - (CGFloat)width;
@@ -77,7 +562,17 @@ static UIColor *kTWDefaultMessageBarStyleSheetInfoStrokeColor = nil;
 - (CGFloat)availableWidth;
 - (CGSize)titleSize;
 - (CGSize)descriptionSize;
+- (CGRect)iconRect;
+- (CGRect)titleRect;
+- (CGRect)descriptionRect;
+- (CGSize)titleSizeForAvailableWidth:(CGFloat)availableWidth maximumTextHeight:(CGFloat)maximumTextHeight;
+- (CGSize)descriptionSizeForAvailableWidth:(CGFloat)availableWidth maximumTextHeight:(CGFloat)maximumTextHeight;
+- (TWMessageBarTextLayout)textLayout;
+- (TWMessageBarTextLayout)textLayoutForWindowSize:(CGSize)windowSize;
+- (CGFloat)maximumTextHeightForWindowHeight:(CGFloat)windowHeight;
+- (BOOL)measureSingleLineString:(NSString *)string scan:(TWMessageBarTextScan)scan attributes:(NSDictionary *)attributes boundedSize:(CGSize)boundedSize size:(CGSize *)size;
 - (CGRect)statusBarFrame;
+- (TWMessageBarStyleAttributes *)styleAttributes;
 - (UIFont *)titleFont;
 - (UIFont *)descriptionFont;
 - (UIColor *)titleColor;
@@ -85,6 +580,9 @@ static UIColor *kTWDefaultMessageBarStyleSheetInfoStrokeColor = nil;
 
 // Helpers
 - (CGRect)orientFrame:(CGRect)frame;
+- (void)traceLifecycleEvent:(NSInteger)event;
+- (void)invalidateTextLayouts;
+- (void)updateLayers;
 
 // Notifications
 - (void)didChangeDeviceOrientation:(NSNotification *)notification;
@@ -94,12 +592,32 @@ static UIColor *kTWDefaultMessageBarStyleSheetInfoStrokeColor = nil;
 @protocol TWMessageViewDelegate <NSObject>
 
 - (NSObject<TWMessageBarStyleSheet> *)styleSheetForMessageView:(TWMessageView *)messageView;
+- (TWMessageBarStyleAttributes *)styleAttributesForMessageView:(TWMessageView *)messageView;
+
+@optional
+
+- (void)messageViewDidChangeHeight:(TWMessageView *)messageView;
 
 @end
 
 @interface TWDefaultMessageBarStyleSheet : NSObject <TWMessageBarStyleSheet>
 
+@property (nonatomic, assign, getter = isOpaque) BOOL opaque;
+
 + (TWDefaultMessageBarStyleSheet *)styleSheet;
++ (TWDefaultMessageBarStyleSheet *)opaqueStyleSheet;
+
+@end
+
+@interface TWMessageBarGlyphAdvanceTable : NSObject
+
+@property (nonatomic, assign, readonly) CGFloat lineHeight;
+
+// Initializers
++ (TWMessageBarGlyphAdvanceTable *)tableForFont:(UIFont *)font;
+
+// Measuring
+- (BOOL)measureCharacters:(const unichar *)characters length:(NSUInteger)length width:(CGFloat *)width;
 
 @end
 
@@ -107,6 +625,39 @@ static UIColor *kTWDefaultMessageBarStyleSheetInfoStrokeColor = nil;
 
 @end
 
+@interface TWMessageBarAnimator : NSObject
+
+@property (nonatomic, strong) id<TWMessageBarClock> clock; // nil ticks on the display link
+
+// Animations
+- (void)animateView:(UIView *)view toOffset:(CGFloat)offset completion:(void (^)(BOOL finished))completion;
+- (void)animateView:(UIView *)view toOffset:(CGFloat)offset initialVelocity:(CGFloat)velocity completion:(void (^)(BOOL finished))completion;
+- (void)stopAnimatingView:(UIView *)view;
+
+@end
+
+@interface TWMessageBarDisplayLinkTarget : NSObject
+
+@property (nonatomic, weak) TWMessageBarAnimator *animator; // the display link retains its target
+
+// Display link
+- (void)displayLinkDidFire:(CADisplayLink *)displayLink;
+
+@end
+
+@interface TWMessageBarScheduledBlock : NSObject
+
+@property (nonatomic, copy) void (^block)(void);
+
+// Actions
+- (void)fire;
+
+@end
+
+@interface TWMessageBarSystemClock : NSObject <TWMessageBarClock>
+
+@end
+
 @interface TWMessageBarViewController : UIViewController
 
 @property (nonatomic, assign) UIStatusBarStyle statusBarStyle;
@@ -114,29 +665,85 @@ static UIColor *kTWDefaultMessageBarStyleSheetInfoStrokeColor = nil;
 
 @end
 
+typedef NS_ENUM(NSInteger, TWMessageBarDismissalReason) {
+    TWMessageBarDismissalReasonTimeout, // the display timer fired
+    TWMessageBarDismissalReasonTap,
+    TWMessageBarDismissalReasonSwipe // released past the dismissal threshold, however slowly
+};
+
+typedef struct {
+    TWMessageBarHistogram timeInQueue;
+    TWMessageBarHistogram timeToVisible;
+    TWMessageBarHistogram visibleDuration;
+    TWMessageBarHistogram queueDepth;
+    NSUInteger enqueuedCount;
+    NSUInteger presentedCount;
+    NSUInteger tappedCount;
+    NSUInteger swipedCount;
+    NSUInteger timedOutCount;
+    NSUInteger discardedCount;
+    NSUInteger coalescedCount;
+} TWMessageBarMetricsStore;
+
 @interface TWMessageBarManager () <TWMessageViewDelegate>
+{
+    TWMessageBarMetricsStore _metricsStore;
+    TWMessageBarStyleAttributes *_styleAttributes[TW_MESSAGE_TYPE_CAPACITY]; // built lazily, indexed by message type
+    TWMessageBarPolicyRecord _policies[TW_MESSAGE_TYPE_CAPACITY]; // compiled, indexed by message type
+    TWMessageBarQueue _queue; // retained TWMessageBarMessage descriptors; views are only created on presentation
+}
 
-@property (nonatomic, strong) NSMutableArray *messageBarQueue;
+@property (nonatomic, strong) NSMutableArray *visibleMessageViews; // top to bottom (front to back)
 @property (nonatomic, assign, getter = isMessageVisible) BOOL messageVisible;
 @property (nonatomic, strong) TWMessageWindow *messageWindow;
 @property (nonatomic, readwrite) NSArray *accessibleElements; // accessibility
-
-// Static
-+ (CGFloat)durationForMessageType:(TWMessageBarMessageType)messageType;
+@property (nonatomic, strong) UIAccessibilityElement *announcementElement; // reused for every announcement
+@property (nonatomic, strong) NSMutableArray *pendingAnnouncements; // message views waiting to be announced
+@property (nonatomic, strong) id announcementTimer; // TWMessageBarClock token
+@property (nonatomic, assign) NSTimeInterval lastAnnouncementTime;
+@property (nonatomic, strong) TWMessageBarAnimator *animator;
 
 // Helpers
 - (void)showNextMessage;
-- (void)generateAccessibleElementWithTitle:(NSString *)title description:(NSString *)description;
+- (void)showNextMessageFadingIn:(BOOL)fadeIn;
+- (void)presentMessageView:(TWMessageView *)messageView fadingIn:(BOOL)fadeIn;
+- (TWMessageView *)messageViewForMessage:(TWMessageBarMessage *)message;
+- (TWMessageBarStyleAttributes *)styleAttributesForMessageType:(TWMessageBarMessageType)type;
+- (void)layoutVisibleMessageViewsFromIndex:(NSUInteger)index;
+- (void)messageViewDidBecomeVisible:(TWMessageView *)messageView;
+- (void)dismissMessageView:(TWMessageView *)messageView reason:(TWMessageBarDismissalReason)reason velocity:(CGFloat)velocity;
+- (void)restoreMessageView:(TWMessageView *)messageView velocity:(CGFloat)velocity;
+- (BOOL)prepareMessage:(TWMessageBarMessage *)message queueDepth:(NSUInteger)queueDepth pendingMessages:(NSArray *)pendingMessages;
+- (void)clampMessage:(TWMessageBarMessage *)message;
+- (BOOL)coalesceMessage:(TWMessageBarMessage *)message pendingMessages:(NSArray *)pendingMessages;
+- (void)enqueueMessage:(TWMessageBarMessage *)message;
+- (void)enqueueMessagesFromArray:(NSArray *)messages;
+- (void)showPreparedMessages:(NSArray *)messages;
+- (TWMessageBarMessage *)queuedMessageAtIndex:(NSUInteger)index;
+- (void)removeAllQueuedMessages;
+- (uint64_t)clockTimestamp;
+- (void)hideMessageWindowIfEmpty;
+
+// Accessibility
+- (void)announceMessageView:(TWMessageView *)messageView;
+- (void)postPendingAnnouncements;
+- (NSString *)announcementForMessageViews:(NSArray *)messageViews;
+
+// Timers
+- (void)scheduleDismissalOfMessageView:(TWMessageView *)messageView;
+- (void)scheduleDismissalOfMessageView:(TWMessageView *)messageView afterDelay:(NSTimeInterval)delay;
+- (void)cancelDismissalOfMessageView:(TWMessageView *)messageView;
 
 // Gestures
 - (void)itemSelected:(UITapGestureRecognizer *)recognizer;
+- (void)itemPanned:(UIPanGestureRecognizer *)recognizer;
 
 // Getters
 - (UIView *)messageWindowView;
 - (TWMessageBarViewController *)messageBarViewController;
 
 // Master presetation
-- (void)showMessageWithTitle:(NSString *)title description:(NSString *)description type:(TWMessageBarMessageType)type duration:(CGFloat)duration statusBarHidden:(BOOL)statusBarHidden statusBarStyle:(UIStatusBarStyle)statusBarStyle callback:(void (^)())callback;
+- (void)showMessageWithTitle:(NSString *)title description:(NSString *)description type:(TWMessageBarMessageType)type duration:(CGFloat)duration statusBarHidden:(BOOL)statusBarHidden statusBarStyle:(UIStatusBarStyle)statusBarStyle overrides:(TWMessageBarMessageOverrides)overrides callback:(void (^)())callback;
 
 @end
 
@@ -161,9 +768,23 @@ static UIColor *kTWDefaultMessageBarStyleSheetInfoStrokeColor = nil;
     return kTWMessageBarManagerDisplayDelay;
 }
 
-+ (CGFloat)durationForMessageType:(TWMessageBarMessageType)messageType
++ (nonnull NSObject<TWMessageBarStyleSheet> *)opaqueDefaultStyleSheet
 {
-    return kTWMessageBarManagerDisplayDelay;
+    return [TWDefaultMessageBarStyleSheet opaqueStyleSheet];
+}
+
++ (TWMessageBarMessageType)registerMessageTypeWithName:(nonnull NSString *)name backgroundColor:(nonnull UIColor *)backgroundColor strokeColor:(nonnull UIColor *)strokeColor iconImage:(nonnull UIImage *)iconImage
+{
+    NSAssert([NSThread isMainThread], @"Message types must be registered on the main thread");
+    NSParameterAssert(name != nil && backgroundColor != nil && strokeColor != nil && iconImage != nil);
+    TWMessageBarMessageTypesInitialize(); // built-ins always own the first IDs
+    return TWMessageBarMessageTypeRegister(name, backgroundColor, strokeColor, iconImage);
+}
+
++ (nullable NSString *)nameForMessageType:(TWMessageBarMessageType)messageType
+{
+    TWMessageBarMessageTypesInitialize();
+    return TWMessageBarMessageTypeIsRegistered(messageType) ? kTWMessageBarMessageTypeNames[messageType] : nil;
 }
 
 #pragma mark - Alloc/Init
@@ -173,317 +794,2055 @@ static UIColor *kTWDefaultMessageBarStyleSheetInfoStrokeColor = nil;
     self = [super init];
     if (self)
     {
-        _messageBarQueue = [[NSMutableArray alloc] init];
+        _visibleMessageViews = [[NSMutableArray alloc] init];
         _messageVisible = NO;
         _styleSheet = [TWDefaultMessageBarStyleSheet styleSheet];
         _managerSupportedOrientationsMask = UIInterfaceOrientationMaskAll;
+        _handoffStyle = TWMessageBarHandoffStyleSequential;
+        _maximumVisibleMessages = 1;
+        _stackStyle = TWMessageBarStackStyleVertical;
+        _animator = [[TWMessageBarAnimator alloc] init];
+        _clock = [[TWMessageBarSystemClock alloc] init];
+        _pendingAnnouncements = [[NSMutableArray alloc] init];
+        
+        TWMessageBarMessageTypesInitialize();
+        for (NSUInteger type = 0; type < TW_MESSAGE_TYPE_CAPACITY; type++)
+        {
+            _policies[type] = TWMessageBarPolicyRecordDefault();
+        }
     }
     return self;
 }
 
+#pragma mark - Memory Management
+
+- (void)dealloc
+{
+    [self removeAllQueuedMessages];
+}
+
 #pragma mark - Public
 
 - (void)showMessageWithTitle:(nullable NSString *)title description:(nullable NSString *)description type:(TWMessageBarMessageType)type
 {
-    [self showMessageWithTitle:title description:description type:type duration:[TWMessageBarManager durationForMessageType:type] callback:nil];
+    [self showMessageWithTitle:title description:description type:type duration:0.0 statusBarHidden:NO statusBarStyle:UIStatusBarStyleDefault overrides:TWMessageBarMessageOverrideNone callback:nil];
 }
 
 - (void)showMessageWithTitle:(nullable NSString *)title description:(nullable NSString *)description type:(TWMessageBarMessageType)type callback:(nullable void (^)())callback
 {
-    [self showMessageWithTitle:title description:description type:type duration:[TWMessageBarManager durationForMessageType:type] callback:callback];
+    [self showMessageWithTitle:title description:description type:type duration:0.0 statusBarHidden:NO statusBarStyle:UIStatusBarStyleDefault overrides:TWMessageBarMessageOverrideNone callback:callback];
 }
 
 - (void)showMessageWithTitle:(nullable NSString *)title description:(nullable NSString *)description type:(TWMessageBarMessageType)type duration:(CGFloat)duration
 {
-    [self showMessageWithTitle:title description:description type:type duration:duration callback:nil];
+    [self showMessageWithTitle:title description:description type:type duration:duration statusBarHidden:NO statusBarStyle:UIStatusBarStyleDefault overrides:TWMessageBarMessageOverrideDuration callback:nil];
 }
 
 - (void)showMessageWithTitle:(nullable NSString *)title description:(nullable NSString *)description type:(TWMessageBarMessageType)type duration:(CGFloat)duration callback:(nullable void (^)())callback
 {
-    [self showMessageWithTitle:title description:description type:type duration:duration statusBarStyle:UIStatusBarStyleDefault callback:callback];
+    [self showMessageWithTitle:title description:description type:type duration:duration statusBarHidden:NO statusBarStyle:UIStatusBarStyleDefault overrides:TWMessageBarMessageOverrideDuration callback:callback];
 }
 
 - (void)showMessageWithTitle:(nullable NSString *)title description:(nullable NSString *)description type:(TWMessageBarMessageType)type statusBarStyle:(UIStatusBarStyle)statusBarStyle callback:(nullable void (^)())callback
 {
-    [self showMessageWithTitle:title description:description type:type duration:kTWMessageBarManagerDisplayDelay statusBarStyle:statusBarStyle callback:callback];
+    [self showMessageWithTitle:title description:description type:type duration:0.0 statusBarHidden:NO statusBarStyle:statusBarStyle overrides:TWMessageBarMessageOverrideStatusBarStyle callback:callback];
 }
 
 - (void)showMessageWithTitle:(nullable NSString *)title description:(nullable NSString *)description type:(TWMessageBarMessageType)type duration:(CGFloat)duration statusBarStyle:(UIStatusBarStyle)statusBarStyle callback:(nullable void (^)())callback
 {
-    [self showMessageWithTitle:title description:description type:type duration:duration statusBarHidden:NO statusBarStyle:statusBarStyle callback:callback];
+    [self showMessageWithTitle:title description:description type:type duration:duration statusBarHidden:NO statusBarStyle:statusBarStyle overrides:TWMessageBarMessageOverrideDuration | TWMessageBarMessageOverrideStatusBarStyle callback:callback];
 }
 
 - (void)showMessageWithTitle:(nullable NSString *)title description:(nullable NSString *)description type:(TWMessageBarMessageType)type statusBarHidden:(BOOL)statusBarHidden callback:(nullable void (^)())callback
 {
-    [self showMessageWithTitle:title description:description type:type duration:[TWMessageBarManager durationForMessageType:type] statusBarHidden:statusBarHidden statusBarStyle:UIStatusBarStyleDefault callback:callback];
+    [self showMessageWithTitle:title description:description type:type duration:0.0 statusBarHidden:statusBarHidden statusBarStyle:UIStatusBarStyleDefault overrides:TWMessageBarMessageOverrideStatusBarHidden callback:callback];
 }
 
 - (void)showMessageWithTitle:(nullable NSString *)title description:(nullable NSString *)description type:(TWMessageBarMessageType)type duration:(CGFloat)duration statusBarHidden:(BOOL)statusBarHidden callback:(nullable void (^)())callback
 {
-    [self showMessageWithTitle:title description:description type:type duration:duration statusBarHidden:statusBarHidden statusBarStyle:UIStatusBarStyleDefault callback:callback];
+    [self showMessageWithTitle:title description:description type:type duration:duration statusBarHidden:statusBarHidden statusBarStyle:UIStatusBarStyleDefault overrides:TWMessageBarMessageOverrideDuration | TWMessageBarMessageOverrideStatusBarHidden callback:callback];
 }
 
-#pragma mark - Master Presentation
-
-- (void)showMessageWithTitle:(NSString *)title description:(NSString *)description type:(TWMessageBarMessageType)type duration:(CGFloat)duration statusBarHidden:(BOOL)statusBarHidden statusBarStyle:(UIStatusBarStyle)statusBarStyle callback:(void (^)())callback
+- (TWMessageBarMessagePolicy)policyForMessageType:(TWMessageBarMessageType)messageType
 {
-    TWMessageView *messageView = [[TWMessageView alloc] initWithTitle:title description:description type:type];
-    messageView.delegate = self;
-    
-    messageView.callbacks = callback ? [NSArray arrayWithObject:callback] : [NSArray array];
-    messageView.hasCallback = callback ? YES : NO;
-    
-    messageView.duration = duration;
-    messageView.hidden = YES;
-    
-    messageView.statusBarStyle = statusBarStyle;
-    messageView.statusBarHidden = statusBarHidden;
-    
-    [[self messageWindowView] addSubview:messageView];
-    [[self messageWindowView] bringSubviewToFront:messageView];
-    
-    [self.messageBarQueue addObject:messageView];
-    
-    if (!self.messageVisible)
-    {
-        [self showNextMessage];
-    }
+    return TWMessageBarPolicyFromPolicyRecord(&_policies[TWMessageBarMessageTypeIndex(messageType)]);
 }
 
-- (void)hideAllAnimated:(BOOL)animated
+- (void)setPolicy:(TWMessageBarMessagePolicy)policy forMessageType:(TWMessageBarMessageType)messageType
 {
-    for (UIView *subview in [[self messageWindowView] subviews])
+    NSParameterAssert(TWMessageBarMessageTypeIsRegistered(messageType));
+    if (!TWMessageBarMessageTypeIsRegistered(messageType))
     {
-        if ([subview isKindOfClass:[TWMessageView class]])
+        return;
+    }
+    
+    NSUInteger index = (NSUInteger)messageType;
+    TWMessageBarPolicyRecord record = TWMessageBarPolicyRecordFromPolicy(policy);
+    if (record.maximumNumberOfLines != _policies[index].maximumNumberOfLines)
+    {
+        _styleAttributes[index] = nil; // rebuilt lazily with the new line cap
+        for (NSUInteger i = 0; i < _queue.count; i++)
         {
-            TWMessageView *currentMessageView = (TWMessageView *)subview;
-            if (animated)
+            TWMessageBarMessage *message = [self queuedMessageAtIndex:i];
+            if (message.type == messageType)
             {
-                [UIView animateWithDuration:kTWMessageBarManagerDismissAnimationDuration animations:^{
-                    currentMessageView.frame = CGRectMake(currentMessageView.frame.origin.x, -currentMessageView.frame.size.height, currentMessageView.frame.size.width, currentMessageView.frame.size.height);
-                } completion:^(BOOL finished) {
-                    [currentMessageView removeFromSuperview];
-                }];
-            }
-            else
-            {
-                [currentMessageView removeFromSuperview];
+                message.clamped = NO;
             }
         }
     }
-    
-    self.messageVisible = NO;
-    [self.messageBarQueue removeAllObjects];
-    [NSObject cancelPreviousPerformRequestsWithTarget:self];
-	self.messageWindow.hidden = YES;
-	self.messageWindow = nil;
+    _policies[index] = record;
 }
 
-- (void)hideAll
+#pragma mark - Master Presentation
+
+- (void)showMessageWithTitle:(NSString *)title description:(NSString *)description type:(TWMessageBarMessageType)type duration:(CGFloat)duration statusBarHidden:(BOOL)statusBarHidden statusBarStyle:(UIStatusBarStyle)statusBarStyle overrides:(TWMessageBarMessageOverrides)overrides callback:(void (^)())callback
 {
-    [self hideAllAnimated:NO];
+    TWMessageBarMessage *message = [TWMessageBarMessage messageWithTitle:title description:description type:type];
+    message.callback = callback;
+    if (overrides & TWMessageBarMessageOverrideDuration)
+    {
+        message.duration = duration;
+    }
+    if (overrides & TWMessageBarMessageOverrideStatusBarHidden)
+    {
+        message.statusBarHidden = statusBarHidden;
+    }
+    if (overrides & TWMessageBarMessageOverrideStatusBarStyle)
+    {
+        message.statusBarStyle = statusBarStyle;
+    }
+    
+    if ([self prepareMessage:message queueDepth:_queue.count pendingMessages:nil])
+    {
+        [self enqueueMessage:message];
+        TWMessageBarTrace(TWMessageBarTraceEventEnqueue, TWMessageBarTracePhaseEnd, message.identifier);
+        [self showNextMessage];
+    }
 }
 
-#pragma mark - Helpers
-
-- (void)showNextMessage
+- (void)showMessages:(nonnull NSArray *)messages
 {
-    if ([self.messageBarQueue count] > 0)
+    // Copied on the calling thread, so callers may reuse their descriptors right away
+    NSMutableArray *batch = [NSMutableArray arrayWithCapacity:[messages count]];
+    for (TWMessageBarMessage *message in messages)
     {
-        self.messageVisible = YES;
-        
-        TWMessageView *messageView = [self.messageBarQueue objectAtIndex:0];
-        [self messageBarViewController].statusBarHidden = messageView.statusBarHidden; // important to do this prior to hiding
-        messageView.frame = CGRectMake(0, -[messageView height], [messageView width], [messageView height]);
-        messageView.hidden = NO;
-        [messageView setNeedsDisplay];
-        
-        UITapGestureRecognizer *gest = [[UITapGestureRecognizer alloc] initWithTarget:self action:@selector(itemSelected:)];
-        [messageView addGestureRecognizer:gest];
-        
-        if (messageView)
+        NSParameterAssert([message isKindOfClass:[TWMessageBarMessage class]]);
+        if ([message isKindOfClass:[TWMessageBarMessage class]])
         {
-            [self.messageBarQueue removeObject:messageView];
-            
-            [self messageBarViewController].statusBarStyle = messageView.statusBarStyle;
-
-            [UIView animateWithDuration:kTWMessageBarManagerDismissAnimationDuration animations:^{
-                [messageView setFrame:CGRectMake(messageView.frame.origin.x, messageView.frame.origin.y + [messageView height], [messageView width], [messageView height])]; // slide down
-            }];
-            [self performSelector:@selector(itemSelected:) withObject:messageView afterDelay:messageView.duration];
-            
-            [self generateAccessibleElementWithTitle:messageView.titleString description:messageView.descriptionString];
+            [batch addObject:[message copy]];
         }
     }
+    if ([batch count] == 0)
+    {
+        return;
+    }
+    
+    if (![NSThread isMainThread])
+    {
+        dispatch_async(dispatch_get_main_queue(), ^{
+            [self showPreparedMessages:batch];
+        });
+        return;
+    }
+    [self showPreparedMessages:batch];
 }
 
-- (void)generateAccessibleElementWithTitle:(NSString *)title description:(NSString *)description
+- (void)hideAllAnimated:(BOOL)animated
 {
-    UIAccessibilityElement *textElement = [[UIAccessibilityElement alloc] initWithAccessibilityContainer:self];
-    textElement.accessibilityLabel = [NSString stringWithFormat:@"%@\n%@", title, description];
-    textElement.accessibilityTraits = UIAccessibilityTraitStaticText;
-    self.accessibleElements = @[textElement];
-    UIAccessibilityPostNotification(UIAccessibilityScreenChangedNotification, self); // notify the accessibility framework to read the message
+    _metricsStore.discardedCount += _queue.count + [self.visibleMessageViews count];
+    
+    // Queued messages are plain descriptors; dropping them never touches a view
+    [self removeAllQueuedMessages];
+    [self.pendingAnnouncements removeAllObjects];
+    if (self.announcementTimer)
+    {
+        [self.clock cancelScheduledBlock:self.announcementTimer];
+        self.announcementTimer = nil;
+    }
+    for (TWMessageView *messageView in self.visibleMessageViews)
+    {
+        [self cancelDismissalOfMessageView:messageView];
+    }
+    [self.visibleMessageViews removeAllObjects];
+    self.messageVisible = NO;
+    
+    if (self.messageWindow == nil)
+    {
+        return;
+    }
+    
+    // Every bar still on screen, including outgoing ones, leaves in a single transaction
+    NSMutableArray *messageViews = [NSMutableArray array];
+    for (UIView *subview in [[self messageWindowView] subviews])
+    {
+        if ([subview isKindOfClass:[TWMessageView class]])
+        {
+            TWMessageView *currentMessageView = (TWMessageView *)subview;
+            [self.animator stopAnimatingView:currentMessageView];
+            [currentMessageView traceLifecycleEvent:TWMessageBarTraceEventSlideOut];
+            currentMessageView.hit = YES;
+            currentMessageView.discarded = YES; // a cross-fade already in flight must not finish its dismissal
+            currentMessageView.userInteractionEnabled = NO;
+            [messageViews addObject:currentMessageView];
+        }
+    }
+    
+    void (^completion)(BOOL) = ^(BOOL finished) {
+        for (TWMessageView *currentMessageView in messageViews)
+        {
+            [currentMessageView traceLifecycleEvent:kTWMessageViewTraceEventNone];
+            [currentMessageView removeFromSuperview];
+        }
+        
+        // Messages shown while the bars were leaving keep the window
+        if ([self.visibleMessageViews count] == 0)
+        {
+            [self hideMessageWindowIfEmpty];
+        }
+    };
+    
+    if (animated && [messageViews count] > 0)
+    {
+        [UIView animateWithDuration:kTWMessageBarManagerDismissAnimationDuration delay:0.0 options:UIViewAnimationOptionBeginFromCurrentState animations:^{
+            for (TWMessageView *currentMessageView in messageViews)
+            {
+                currentMessageView.frame = CGRectMake(currentMessageView.frame.origin.x, -currentMessageView.frame.size.height, currentMessageView.frame.size.width, currentMessageView.frame.size.height);
+            }
+        } completion:completion];
+    }
+    else
+    {
+        completion(YES);
+    }
 }
 
-#pragma mark - Gestures
+- (void)hideAll
+{
+    [self hideAllAnimated:NO];
+}
 
-- (void)itemSelected:(id)sender
+#pragma mark - Helpers
+
+- (void)showNextMessage
 {
-    TWMessageView *messageView = nil;
-    BOOL itemHit = NO;
-    if ([sender isKindOfClass:[UIGestureRecognizer class]])
+    [self showNextMessageFadingIn:NO];
+}
+
+- (void)showNextMessageFadingIn:(BOOL)fadeIn
+{
+    // Fill every free slot; a single slot unless messages are stacked
+    while (_queue.count > 0 && [self.visibleMessageViews count] < MAX(self.maximumVisibleMessages, 1))
     {
-        messageView = (TWMessageView *)((UIGestureRecognizer *)sender).view;
-        itemHit = YES;
+        TWMessageBarMessage *message = (__bridge_transfer TWMessageBarMessage *)TWMessageBarQueueDequeue(&_queue);
+        [self presentMessageView:[self messageViewForMessage:message] fadingIn:fadeIn];
     }
-    else if ([sender isKindOfClass:[TWMessageView class]])
+}
+
+- (TWMessageView *)messageViewForMessage:(TWMessageBarMessage *)message
+{
+    if (![message isClamped])
     {
-        messageView = (TWMessageView *)sender;
+        [self clampMessage:message]; // the style sheet or line cap changed while it was queued
     }
     
-    if (messageView && ![messageView isHit])
+    TWMessageView *messageView = [[TWMessageView alloc] initWithTitle:message.clampedTitle description:message.clampedDescription type:message.type];
+    messageView.sourceTitle = message.title;
+    messageView.titleScan = message.titleScan;
+    messageView.descriptionScan = message.descriptionScan;
+    messageView.delegate = self;
+    [messageView updateLayers];
+    
+    messageView.callbacks = message.callback ? [NSArray arrayWithObject:message.callback] : [NSArray array];
+    messageView.hasCallback = message.callback ? YES : NO;
+    
+    messageView.duration = message.duration;
+    messageView.messageIdentifier = message.identifier;
+    messageView.enqueueTimestamp = message.enqueueTimestamp;
+    
+    messageView.statusBarStyle = message.statusBarStyle;
+    messageView.statusBarHidden = message.statusBarHidden;
+    
+    return messageView;
+}
+
+- (void)presentMessageView:(TWMessageView *)messageView fadingIn:(BOOL)fadeIn
+{
+    TWMessageBarHistogramRecord(&_metricsStore.timeInQueue, ([self clockTimestamp] - messageView.enqueueTimestamp) / NSEC_PER_USEC);
+    _metricsStore.presentedCount++;
+    
+    self.messageVisible = YES;
+    [self.visibleMessageViews addObject:messageView];
+    
+    [self messageBarViewController].statusBarHidden = messageView.statusBarHidden; // important to do this prior to hiding
+    [self messageBarViewController].statusBarStyle = messageView.statusBarStyle;
+    
+    // Measured once; the stack layout only ever reuses this height
+    TWMessageBarTrace(TWMessageBarTraceEventLayout, TWMessageBarTracePhaseBegin, messageView.messageIdentifier);
+    CGFloat height = [messageView height];
+    TWMessageBarTrace(TWMessageBarTraceEventLayout, TWMessageBarTracePhaseEnd, messageView.messageIdentifier);
+    messageView.frame = CGRectMake(0, fadeIn ? 0.0 : -height, [messageView width], height);
+    [messageView setNeedsDisplay];
+    
+    if ([self.visibleMessageViews count] > 1)
     {
-        messageView.hit = YES;
-        
-        [UIView animateWithDuration:kTWMessageBarManagerDismissAnimationDuration animations:^{
-            [messageView setFrame:CGRectMake(messageView.frame.origin.x, messageView.frame.origin.y - [messageView height], [messageView width], [messageView height])]; // slide back up
+        // Stacked bars slide in (and tuck) behind the bars presented before them
+        [[self messageWindowView] insertSubview:messageView belowSubview:[self.visibleMessageViews objectAtIndex:[self.visibleMessageViews count] - 2]];
+    }
+    else
+    {
+        [[self messageWindowView] addSubview:messageView];
+    }
+    
+    UITapGestureRecognizer *gest = [[UITapGestureRecognizer alloc] initWithTarget:self action:@selector(itemSelected:)];
+    [messageView addGestureRecognizer:gest];
+    
+    UIPanGestureRecognizer *panGesture = [[UIPanGestureRecognizer alloc] initWithTarget:self action:@selector(itemPanned:)];
+    [messageView addGestureRecognizer:panGesture];
+    
+    [messageView traceLifecycleEvent:TWMessageBarTraceEventSlideIn];
+    
+    if (fadeIn)
+    {
+        messageView.restingOffset = 0.0;
+        messageView.alpha = 0.0;
+        [UIView animateWithDuration:kTWMessageBarManagerDismissAnimationDuration delay:0.0 options:UIViewAnimationOptionAllowUserInteraction animations:^{
+            messageView.alpha = 1.0;
         } completion:^(BOOL finished) {
-            if (itemHit)
-            {
-                if ([messageView.callbacks count] > 0)
-                {
-                    id obj = [messageView.callbacks objectAtIndex:0];
-                    if (![obj isEqual:[NSNull null]])
-                    {
-                        ((void (^)())obj)();
-                    }
-                }
-            }
-            
-            self.messageVisible = NO;
-            [messageView removeFromSuperview];
-            
-            if([self.messageBarQueue count] > 0)
+            if (messageView.traceEvent == TWMessageBarTraceEventSlideIn)
             {
-                [self showNextMessage];
+                [self messageViewDidBecomeVisible:messageView];
             }
-            else
+        }];
+    }
+    else
+    {
+        [self layoutVisibleMessageViewsFromIndex:[self.visibleMessageViews count] - 1]; // slide down
+    }
+    
+    [messageView captureBackground]; // once the resting offset is known; reused for the whole animation
+    
+    [self scheduleDismissalOfMessageView:messageView];
+    
+    [self announceMessageView:messageView];
+}
+
+- (void)layoutVisibleMessageViewsFromIndex:(NSUInteger)index
+{
+    NSUInteger count = [self.visibleMessageViews count];
+    if (index >= count)
+    {
+        return;
+    }
+    
+    double heights[count];
+    double offsets[count];
+    for (NSUInteger i = 0; i < count; i++)
+    {
+        TWMessageView *messageView = [self.visibleMessageViews objectAtIndex:i];
+        heights[i] = messageView.frame.size.height;
+        offsets[i] = messageView.restingOffset;
+    }
+    
+    TWMessageView *firstMessageView = [self.visibleMessageViews objectAtIndex:0];
+    TWMessageBarStackLayout(heights, offsets, count, index, [firstMessageView statusBarOffset], kTWMessageBarManagerStackCardPeek, self.stackStyle == TWMessageBarStackStyleCollapsed);
+    
+    CGFloat windowHeight = [self messageWindowView].bounds.size.height;
+    for (NSUInteger i = index; i < count; i++)
+    {
+        TWMessageView *messageView = [self.visibleMessageViews objectAtIndex:i];
+        BOOL moved = messageView.restingOffset != (CGFloat)offsets[i];
+        messageView.restingOffset = (CGFloat)offsets[i];
+        
+        // Bars stacked past the bottom of the screen give up their backing stores until they move back up
+        BOOL offscreen = messageView.restingOffset >= windowHeight;
+        if (!offscreen)
+        {
+            if (moved && messageView.backgroundImage && ![messageView isBackingStoreReleased])
             {
-				self.messageWindow.hidden = YES;
-				self.messageWindow = nil;
+                [messageView captureBackground]; // the snapshot shows what was beneath the old resting place
             }
-        }];
+            [messageView restoreBackingStore];
+        }
+        if (![messageView isTracking])
+        {
+            [self.animator animateView:messageView toOffset:messageView.restingOffset completion:^(BOOL finished) {
+                if (finished && offscreen)
+                {
+                    [messageView releaseBackingStore];
+                }
+                if (finished && messageView.traceEvent == TWMessageBarTraceEventSlideIn)
+                {
+                    [self messageViewDidBecomeVisible:messageView];
+                }
+            }];
+        }
     }
 }
 
-#pragma mark - Getters
+- (void)messageViewDidBecomeVisible:(TWMessageView *)messageView
+{
+    [messageView traceLifecycleEvent:TWMessageBarTraceEventVisible];
+    
+    if (messageView.visibleTimestamp == 0)
+    {
+        messageView.visibleTimestamp = [self clockTimestamp];
+        TWMessageBarHistogramRecord(&_metricsStore.timeToVisible, (messageView.visibleTimestamp - messageView.enqueueTimestamp) / NSEC_PER_USEC);
+    }
+}
 
-- (UIView *)messageWindowView
+- (BOOL)prepareMessage:(TWMessageBarMessage *)message queueDepth:(NSUInteger)queueDepth pendingMessages:(NSArray *)pendingMessages
 {
-    return [self messageBarViewController].view;
+    message.identifier = ++kTWMessageBarManagerMessageIdentifier;
+    TWMessageBarTrace(TWMessageBarTraceEventEnqueue, TWMessageBarTracePhaseBegin, message.identifier);
+    
+    TWMessageBarHistogramRecord(&_metricsStore.queueDepth, queueDepth);
+    _metricsStore.enqueuedCount++;
+    
+    // Values the caller didn't supply come from the compiled policy record
+    const TWMessageBarPolicyRecord *policy = &_policies[TWMessageBarMessageTypeIndex(message.type)];
+    TWMessageBarPresentation presentation = {message.duration, 0, message.statusBarHidden, message.statusBarStyle};
+    TWMessageBarPolicyResolve(policy, message.overrides, &presentation);
+    message.duration = (CGFloat)presentation.duration;
+    message.statusBarStyle = (UIStatusBarStyle)presentation.statusBarStyle;
+    message.statusBarHidden = presentation.statusBarHidden ? YES : NO;
+    message.priority = (NSInteger)presentation.priority;
+    
+    if (policy->coalesces && [self coalesceMessage:message pendingMessages:pendingMessages])
+    {
+        _metricsStore.coalescedCount++;
+        TWMessageBarTrace(TWMessageBarTraceEventEnqueue, TWMessageBarTracePhaseEnd, message.identifier);
+        return NO;
+    }
+    
+    message.enqueueTimestamp = [self clockTimestamp];
+    [self clampMessage:message];
+    return YES;
 }
 
-- (TWMessageBarViewController *)messageBarViewController
+- (void)clampMessage:(TWMessageBarMessage *)message
 {
-    if (!self.messageWindow)
+    // Truncate up front so measuring and drawing only ever see the text that can be visible
+    TWMessageBarStyleAttributes *styleAttributes = [self styleAttributesForMessageType:message.type];
+    TWMessageBarTextScan titleScan, descriptionScan;
+    message.clampedTitle = [TWMessageView clampedString:message.title maximumCharacters:styleAttributes.titleMaximumLength maximumLines:styleAttributes.titleMaximumNumberOfLines scan:&titleScan];
+    message.clampedDescription = [TWMessageView clampedString:message.messageDescription maximumCharacters:styleAttributes.descriptionMaximumLength maximumLines:styleAttributes.descriptionMaximumNumberOfLines scan:&descriptionScan];
+    message.titleScan = titleScan;
+    message.descriptionScan = descriptionScan;
+    message.clamped = YES;
+}
+
+- (BOOL)coalesceMessage:(TWMessageBarMessage *)message pendingMessages:(NSArray *)pendingMessages
+{
+    NSString *title = message.title;
+    
+    // On screen: redrawn in place (only the text when the height holds) and its timer restarted
+    for (TWMessageView *messageView in self.visibleMessageViews)
     {
-        self.messageWindow = [[TWMessageWindow alloc] init];
-        self.messageWindow.frame = [UIApplication sharedApplication].keyWindow.frame;
-        self.messageWindow.hidden = NO;
-        self.messageWindow.windowLevel = UIWindowLevelNormal;
-        self.messageWindow.backgroundColor = [UIColor clearColor];
-        self.messageWindow.rootViewController = [[TWMessageBarViewController alloc] init];
+        if (messageView.messageType != message.type || [messageView isHit] || !(messageView.sourceTitle == title || [messageView.sourceTitle isEqualToString:title]))
+        {
+            continue;
+        }
+        
+        TWMessageBarTrace(TWMessageBarTraceEventCoalesce, TWMessageBarTracePhaseBegin, messageView.messageIdentifier);
+        [messageView updateTitle:title description:message.messageDescription];
+        messageView.duration = message.duration;
+        if (message.callback && !messageView.hasCallback)
+        {
+            messageView.callbacks = [NSArray arrayWithObject:message.callback];
+            messageView.hasCallback = YES;
+        }
+        if (messageView.dismissTimer)
+        {
+            [self scheduleDismissalOfMessageView:messageView]; // a bar being dragged rearms on release
+        }
+        if (![self.pendingAnnouncements containsObject:messageView])
+        {
+            [self announceMessageView:messageView];
+        }
+        TWMessageBarTrace(TWMessageBarTraceEventCoalesce, TWMessageBarTracePhaseEnd, messageView.messageIdentifier);
+        return YES;
     }
-    return (TWMessageBarViewController *)self.messageWindow.rootViewController;
+    
+    // Queued (or earlier in the same batch): the descriptor takes the latest text and keeps its place in line
+    NSUInteger queueCount = _queue.count;
+    for (NSUInteger i = 0; i < queueCount + [pendingMessages count]; i++)
+    {
+        TWMessageBarMessage *queuedMessage = i < queueCount ? [self queuedMessageAtIndex:i] : [pendingMessages objectAtIndex:i - queueCount];
+        if (queuedMessage.type != message.type || !(queuedMessage.title == title || [queuedMessage.title isEqualToString:title]))
+        {
+            continue;
+        }
+        
+        TWMessageBarTrace(TWMessageBarTraceEventCoalesce, TWMessageBarTracePhaseBegin, queuedMessage.identifier);
+        queuedMessage.messageDescription = message.messageDescription;
+        queuedMessage.duration = message.duration;
+        if (message.callback && !queuedMessage.callback)
+        {
+            queuedMessage.callback = message.callback;
+        }
+        [self clampMessage:queuedMessage];
+        TWMessageBarTrace(TWMessageBarTraceEventCoalesce, TWMessageBarTracePhaseEnd, queuedMessage.identifier);
+        return YES;
+    }
+    return NO;
 }
 
-- (NSArray *)accessibleElements
+- (void)enqueueMessage:(TWMessageBarMessage *)message
 {
-    if (_accessibleElements != nil)
+    void *payload = (__bridge_retained void *)message;
+    if (!TWMessageBarQueueEnqueue(&_queue, payload, message.priority))
     {
-        return _accessibleElements;
+        CFBridgingRelease(payload);
+        _metricsStore.discardedCount++;
     }
-    _accessibleElements = [NSArray array];
-    return _accessibleElements;
 }
 
-#pragma mark - Setters
+- (void)enqueueMessagesFromArray:(NSArray *)messages
+{
+    NSUInteger count = [messages count];
+    if (count == 0)
+    {
+        return;
+    }
+    
+    TWMessageBarQueueEntry *entries = malloc(count * sizeof(TWMessageBarQueueEntry));
+    if (entries == NULL)
+    {
+        _metricsStore.discardedCount += count;
+        return;
+    }
+    NSUInteger index = 0;
+    for (TWMessageBarMessage *message in messages)
+    {
+        entries[index].payload = (__bridge void *)message;
+        entries[index].priority = message.priority;
+        index++;
+    }
+    
+    // Retained only once they are in; the entries are sorted in place, so every one is still in the batch
+    if (TWMessageBarQueueEnqueueEntries(&_queue, entries, count))
+    {
+        for (NSUInteger i = 0; i < count; i++)
+        {
+            CFBridgingRetain((__bridge id)entries[i].payload);
+        }
+    }
+    else
+    {
+        _metricsStore.discardedCount += count;
+    }
+    free(entries);
+}
 
-- (void)setStyleSheet:(NSObject<TWMessageBarStyleSheet> *)styleSheet
+- (void)showPreparedMessages:(NSArray *)messages
 {
-    if (styleSheet != nil)
+    // One pass resolves, coalesces and measures; the queue then changes once and presentation is kicked at most once
+    NSUInteger queueDepth = _queue.count;
+    NSMutableArray *pendingMessages = [NSMutableArray arrayWithCapacity:[messages count]];
+    for (TWMessageBarMessage *message in messages)
     {
-        _styleSheet = styleSheet;
+        if ([self prepareMessage:message queueDepth:queueDepth + [pendingMessages count] pendingMessages:pendingMessages])
+        {
+            [pendingMessages addObject:message];
+        }
+    }
+    if ([pendingMessages count] == 0)
+    {
+        return;
+    }
+    
+    [self enqueueMessagesFromArray:pendingMessages];
+    for (TWMessageBarMessage *message in pendingMessages)
+    {
+        TWMessageBarTrace(TWMessageBarTraceEventEnqueue, TWMessageBarTracePhaseEnd, message.identifier);
     }
+    
+    [self showNextMessage];
 }
 
-#pragma mark - TWMessageViewDelegate
+- (TWMessageBarStyleAttributes *)styleAttributesForMessageType:(TWMessageBarMessageType)type
+{
+    NSUInteger index = TWMessageBarMessageTypeIndex(type);
+    if (_styleAttributes[index] == nil)
+    {
+        _styleAttributes[index] = [[TWMessageBarStyleAttributes alloc] initWithStyleSheet:self.styleSheet type:(TWMessageBarMessageType)index maximumNumberOfLines:_policies[index].maximumNumberOfLines];
+    }
+    return _styleAttributes[index];
+}
 
-- (NSObject<TWMessageBarStyleSheet> *)styleSheetForMessageView:(TWMessageView *)messageView
+- (TWMessageBarMessage *)queuedMessageAtIndex:(NSUInteger)index
 {
-    return self.styleSheet;
+    return (__bridge TWMessageBarMessage *)TWMessageBarQueuePayloadAtIndex(&_queue, index);
 }
 
-#pragma mark - UIAccessibilityContainer
+- (void)removeAllQueuedMessages
+{
+    for (NSUInteger i = 0; i < _queue.count; i++)
+    {
+        CFBridgingRelease(TWMessageBarQueuePayloadAtIndex(&_queue, i));
+    }
+    TWMessageBarQueueRemoveAll(&_queue);
+}
 
-- (NSInteger)accessibilityElementCount
+- (uint64_t)clockTimestamp
 {
-    return (NSInteger)[self.accessibleElements count];
+    return (uint64_t)([self.clock currentTime] * NSEC_PER_SEC);
+}
+
+- (void)hideMessageWindowIfEmpty
+{
+    // Outgoing bars are no longer in visibleMessageViews but are still animating in the window
+    for (UIView *subview in self.messageWindow.rootViewController.view.subviews)
+    {
+        if ([subview isKindOfClass:[TWMessageView class]])
+        {
+            return;
+        }
+    }
+    self.messageWindow.hidden = YES;
+    self.messageWindow = nil;
+}
+
+#pragma mark - Accessibility
+
+- (void)announceMessageView:(TWMessageView *)messageView
+{
+    [self.pendingAnnouncements addObject:messageView];
+    if (self.announcementTimer)
+    {
+        return; // coalesced into the announcement already scheduled
+    }
+    
+    // Wait briefly for the rest of a burst, and never post screen changes closer together than the minimum interval
+    NSTimeInterval now = [self.clock currentTime];
+    NSTimeInterval delay = MAX(kTWMessageBarManagerAnnouncementCoalescingInterval, (self.lastAnnouncementTime + kTWMessageBarManagerAnnouncementMinimumInterval) - now);
+    if (self.lastAnnouncementTime == 0.0)
+    {
+        delay = kTWMessageBarManagerAnnouncementCoalescingInterval;
+    }
+    
+    __weak TWMessageBarManager *weakSelf = self;
+    self.announcementTimer = [self.clock scheduleBlock:^{
+        [weakSelf postPendingAnnouncements];
+    } afterDelay:delay];
+}
+
+- (void)postPendingAnnouncements
+{
+    self.announcementTimer = nil;
+    if ([self.pendingAnnouncements count] == 0)
+    {
+        return;
+    }
+    
+    if (self.announcementElement == nil)
+    {
+        self.announcementElement = [[UIAccessibilityElement alloc] initWithAccessibilityContainer:self];
+        self.announcementElement.accessibilityTraits = UIAccessibilityTraitStaticText;
+    }
+    self.announcementElement.accessibilityLabel = [self announcementForMessageViews:self.pendingAnnouncements];
+    [self.pendingAnnouncements removeAllObjects];
+    
+    self.accessibleElements = @[self.announcementElement];
+    self.lastAnnouncementTime = [self.clock currentTime];
+    UIAccessibilityPostNotification(UIAccessibilityScreenChangedNotification, self); // notify the accessibility framework to read the message
 }
 
-- (id)accessibilityElementAtIndex:(NSInteger)index
-{
-    return [self.accessibleElements objectAtIndex:(NSUInteger)index];
-}
+- (NSString *)announcementForMessageViews:(NSArray *)messageViews
+{
+    if ([messageViews count] == 1)
+    {
+        TWMessageView *messageView = [messageViews firstObject];
+        return [NSString stringWithFormat:@"%@\n%@", messageView.titleString, messageView.descriptionString];
+    }
+    
+    // "3 errors, 1 success: First title. Second title. ..."
+    NSUInteger counts[TW_MESSAGE_TYPE_CAPACITY] = {0};
+    NSMutableArray *titles = [NSMutableArray arrayWithCapacity:[messageViews count]];
+    for (TWMessageView *messageView in messageViews)
+    {
+        counts[TWMessageBarMessageTypeIndex(messageView.messageType)]++;
+        if ([messageView.titleString length] > 0)
+        {
+            [titles addObject:messageView.titleString];
+        }
+    }
+    
+    NSMutableArray *summaries = [NSMutableArray array];
+    if (counts[TWMessageBarMessageTypeError] > 0)
+    {
+        [summaries addObject:[NSString stringWithFormat:(counts[TWMessageBarMessageTypeError] == 1 ? kTWMessageBarManagerAnnouncementErrorFormat : kTWMessageBarManagerAnnouncementErrorsFormat), (unsigned long)counts[TWMessageBarMessageTypeError]]];
+    }
+    if (counts[TWMessageBarMessageTypeSuccess] > 0)
+    {
+        [summaries addObject:[NSString stringWithFormat:(counts[TWMessageBarMessageTypeSuccess] == 1 ? kTWMessageBarManagerAnnouncementSuccessFormat : kTWMessageBarManagerAnnouncementSuccessesFormat), (unsigned long)counts[TWMessageBarMessageTypeSuccess]]];
+    }
+    if (counts[TWMessageBarMessageTypeInfo] > 0)
+    {
+        [summaries addObject:[NSString stringWithFormat:(counts[TWMessageBarMessageTypeInfo] == 1 ? kTWMessageBarManagerAnnouncementInfoFormat : kTWMessageBarManagerAnnouncementInfosFormat), (unsigned long)counts[TWMessageBarMessageTypeInfo]]];
+    }
+    for (NSUInteger type = TWMessageBarMessageTypeInfo + 1; type < kTWMessageBarMessageTypeCount; type++)
+    {
+        if (counts[type] > 0)
+        {
+            [summaries addObject:[NSString stringWithFormat:kTWMessageBarManagerAnnouncementCustomFormat, (unsigned long)counts[type], kTWMessageBarMessageTypeNames[type]]];
+        }
+    }
+    
+    NSString *summary = [summaries componentsJoinedByString:@", "];
+    if ([titles count] == 0)
+    {
+        return summary;
+    }
+    return [NSString stringWithFormat:@"%@: %@", summary, [titles componentsJoinedByString:@". "]];
+}
+
+#pragma mark - Timers
+
+- (void)scheduleDismissalOfMessageView:(TWMessageView *)messageView
+{
+    [self scheduleDismissalOfMessageView:messageView afterDelay:messageView.duration];
+}
+
+- (void)scheduleDismissalOfMessageView:(TWMessageView *)messageView afterDelay:(NSTimeInterval)delay
+{
+    [self cancelDismissalOfMessageView:messageView];
+    
+    __weak TWMessageBarManager *weakSelf = self;
+    __weak TWMessageView *weakMessageView = messageView;
+    messageView.dismissTime = [self.clock currentTime] + delay;
+    messageView.dismissTimer = [self.clock scheduleBlock:^{
+        weakMessageView.dismissTimer = nil;
+        [weakSelf itemSelected:weakMessageView];
+    } afterDelay:delay];
+}
+
+- (void)cancelDismissalOfMessageView:(TWMessageView *)messageView
+{
+    if (messageView.dismissTimer)
+    {
+        [self.clock cancelScheduledBlock:messageView.dismissTimer];
+        messageView.dismissTimer = nil;
+    }
+}
+
+#pragma mark - Gestures
+
+- (void)itemSelected:(id)sender
+{
+    TWMessageView *messageView = nil;
+    TWMessageBarDismissalReason reason = TWMessageBarDismissalReasonTimeout;
+    if ([sender isKindOfClass:[UIGestureRecognizer class]])
+    {
+        messageView = (TWMessageView *)((UIGestureRecognizer *)sender).view;
+        reason = TWMessageBarDismissalReasonTap;
+    }
+    else if ([sender isKindOfClass:[TWMessageView class]])
+    {
+        messageView = (TWMessageView *)sender; // the display timer
+        reason = TWMessageBarDismissalReasonTimeout;
+    }
+    
+    if (messageView && ![messageView isHit])
+    {
+        [self dismissMessageView:messageView reason:reason velocity:0.0];
+    }
+}
+
+- (void)itemPanned:(UIPanGestureRecognizer *)recognizer
+{
+    TWMessageView *messageView = (TWMessageView *)recognizer.view;
+    UIView *superview = messageView.superview;
+    
+    switch (recognizer.state)
+    {
+        case UIGestureRecognizerStateBegan:
+        {
+            /*
+             * Catch the bar wherever it currently is on screen, even mid-animation.
+             * Interrupted dismissals are abandoned (see dismissMessageView:reason:velocity:).
+             */
+            [self.animator stopAnimatingView:messageView];
+            [self messageViewDidBecomeVisible:messageView];
+            messageView.hit = NO;
+            messageView.tracking = YES;
+            
+            [self cancelDismissalOfMessageView:messageView];
+            break;
+        }
+        case UIGestureRecognizerStateChanged:
+        {
+            // Follow the finger (upwards only); translation is consumed on every touch update
+            CGFloat translation = [recognizer translationInView:superview].y;
+            [recognizer setTranslation:CGPointZero inView:superview];
+            messageView.frame = CGRectMake(messageView.frame.origin.x, MIN(messageView.frame.origin.y + translation, messageView.restingOffset), messageView.frame.size.width, messageView.frame.size.height);
+            break;
+        }
+        case UIGestureRecognizerStateEnded:
+        case UIGestureRecognizerStateCancelled:
+        {
+            messageView.tracking = NO;
+            
+            // Project where the bar would come to rest if released with its current velocity
+            CGFloat velocity = [recognizer velocityInView:superview].y;
+            CGFloat projectedOffset = TWMessageBarDecayProjectedPosition(messageView.frame.origin.y, velocity, kTWMessageBarManagerPanDecayTimeConstant);
+            
+            if (projectedOffset < messageView.restingOffset - (messageView.frame.size.height * 0.5f))
+            {
+                [self dismissMessageView:messageView reason:TWMessageBarDismissalReasonSwipe velocity:velocity];
+            }
+            else
+            {
+                [self restoreMessageView:messageView velocity:velocity];
+            }
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+#pragma mark - Animations
+
+- (void)dismissMessageView:(TWMessageView *)messageView reason:(TWMessageBarDismissalReason)reason velocity:(CGFloat)velocity
+{
+    messageView.hit = YES;
+    messageView.dismissTimestamp = [self clockTimestamp];
+    [messageView traceLifecycleEvent:TWMessageBarTraceEventSlideOut];
+    
+    [self cancelDismissalOfMessageView:messageView];
+    
+    /*
+     * Stacks and overlapping hand-offs release the bar's slot right away: the remaining bars reflow
+     * and the next queued message is presented while this one is still leaving the screen.
+     */
+    TWMessageBarSlotRelease slotRelease = TWMessageBarSlotReleaseForDismissal((TWMessageBarHandoffMode)self.handoffStyle, self.maximumVisibleMessages, _queue.count);
+    BOOL handoff = slotRelease != TWMessageBarSlotReleaseOnRemoval;
+    BOOL crossFade = slotRelease == TWMessageBarSlotReleaseOnDismissalCrossFading;
+    
+    void (^completion)(BOOL) = ^(BOOL finished) {
+        if (!finished || ![messageView isHit])
+        {
+            return; // interrupted by a pan; the gesture now owns the bar
+        }
+        if ([messageView isDiscarded])
+        {
+            return; // hideAll took the bar over and already counted it
+        }
+        
+        [messageView traceLifecycleEvent:kTWMessageViewTraceEventNone];
+        
+        if (messageView.visibleTimestamp > 0 && messageView.dismissTimestamp > messageView.visibleTimestamp)
+        {
+            TWMessageBarHistogramRecord(&self->_metricsStore.visibleDuration, (messageView.dismissTimestamp - messageView.visibleTimestamp) / NSEC_PER_USEC);
+        }
+        switch (reason)
+        {
+            case TWMessageBarDismissalReasonTap:
+                self->_metricsStore.tappedCount++;
+                break;
+            case TWMessageBarDismissalReasonSwipe:
+                self->_metricsStore.swipedCount++;
+                break;
+            case TWMessageBarDismissalReasonTimeout:
+                self->_metricsStore.timedOutCount++;
+                break;
+        }
+        
+        if (reason == TWMessageBarDismissalReasonTap)
+        {
+            if ([messageView.callbacks count] > 0)
+            {
+                id obj = [messageView.callbacks objectAtIndex:0];
+                if (![obj isEqual:[NSNull null]])
+                {
+                    TWMessageBarTrace(TWMessageBarTraceEventCallback, TWMessageBarTracePhaseBegin, messageView.messageIdentifier);
+                    ((void (^)())obj)();
+                    TWMessageBarTrace(TWMessageBarTraceEventCallback, TWMessageBarTracePhaseEnd, messageView.messageIdentifier);
+                }
+            }
+        }
+        
+        [messageView removeFromSuperview];
+        
+        if (!handoff)
+        {
+            [self.visibleMessageViews removeObjectIdenticalTo:messageView];
+            [self showNextMessage];
+        }
+        
+        if ([self.visibleMessageViews count] == 0)
+        {
+            self.messageVisible = NO;
+            [self hideMessageWindowIfEmpty];
+        }
+    };
+    
+    if (handoff)
+    {
+        messageView.userInteractionEnabled = NO; // can't be caught again once its slot is reused
+        
+        NSUInteger index = [self.visibleMessageViews indexOfObjectIdenticalTo:messageView];
+        [self.visibleMessageViews removeObjectIdenticalTo:messageView];
+        self.messageVisible = [self.visibleMessageViews count] > 0;
+        [self layoutVisibleMessageViewsFromIndex:index];
+        [self showNextMessageFadingIn:crossFade];
+    }
+    
+    if (crossFade)
+    {
+        [UIView animateWithDuration:kTWMessageBarManagerDismissAnimationDuration animations:^{
+            messageView.alpha = 0.0;
+        } completion:completion];
+        return;
+    }
+    
+    // Flung bars keep the release velocity; otherwise the slide up is retargeted from wherever the bar is
+    CGFloat offset = -messageView.frame.size.height; // slide back up
+    if (velocity != 0.0f)
+    {
+        [self.animator animateView:messageView toOffset:offset initialVelocity:velocity completion:completion];
+    }
+    else
+    {
+        [self.animator animateView:messageView toOffset:offset completion:completion];
+    }
+}
+
+- (void)restoreMessageView:(TWMessageView *)messageView velocity:(CGFloat)velocity
+{
+    [self.animator animateView:messageView toOffset:messageView.restingOffset initialVelocity:velocity completion:nil]; // snap back down
+    
+    // The display timer restarts once the user lets go
+    [self scheduleDismissalOfMessageView:messageView];
+}
+
+#pragma mark - Getters
+
+- (UIView *)messageWindowView
+{
+    return [self messageBarViewController].view;
+}
+
+- (TWMessageBarViewController *)messageBarViewController
+{
+    if (!self.messageWindow)
+    {
+        self.messageWindow = [[TWMessageWindow alloc] init];
+        self.messageWindow.frame = [UIApplication sharedApplication].keyWindow.frame;
+        self.messageWindow.hidden = NO;
+        self.messageWindow.windowLevel = UIWindowLevelNormal;
+        self.messageWindow.backgroundColor = [UIColor clearColor];
+        self.messageWindow.rootViewController = [[TWMessageBarViewController alloc] init];
+    }
+    return (TWMessageBarViewController *)self.messageWindow.rootViewController;
+}
+
+- (NSArray *)accessibleElements
+{
+    if (_accessibleElements != nil)
+    {
+        return _accessibleElements;
+    }
+    _accessibleElements = [NSArray array];
+    return _accessibleElements;
+}
+
+- (NSUInteger)styleAttributesAllocationCount
+{
+    return kTWMessageBarStyleAttributesAllocationCount;
+}
+
+- (TWMessageBarMetrics)metrics
+{
+    TWMessageBarMetrics metrics;
+    metrics.enqueuedCount = _metricsStore.enqueuedCount;
+    metrics.presentedCount = _metricsStore.presentedCount;
+    metrics.tappedCount = _metricsStore.tappedCount;
+    metrics.swipedCount = _metricsStore.swipedCount;
+    metrics.timedOutCount = _metricsStore.timedOutCount;
+    metrics.discardedCount = _metricsStore.discardedCount;
+    metrics.coalescedCount = _metricsStore.coalescedCount;
+    metrics.timeInQueue = TWMessageBarHistogramSummarize(&_metricsStore.timeInQueue);
+    metrics.timeToVisible = TWMessageBarHistogramSummarize(&_metricsStore.timeToVisible);
+    metrics.visibleDuration = TWMessageBarHistogramSummarize(&_metricsStore.visibleDuration);
+    metrics.queueDepth = TWMessageBarHistogramSummarize(&_metricsStore.queueDepth);
+    
+    // Includes bars still sliding out
+    metrics.backingStoreBytes = 0;
+    for (UIView *subview in [self.messageWindow.rootViewController.view subviews])
+    {
+        if ([subview isKindOfClass:[TWMessageView class]])
+        {
+            metrics.backingStoreBytes += [(TWMessageView *)subview backingStoreBytes];
+        }
+    }
+    return metrics;
+}
+
+#pragma mark - Metrics
+
+- (void)resetMetrics
+{
+    memset(&_metricsStore, 0, sizeof(_metricsStore));
+}
+
+#pragma mark - Setters
+
+- (void)setClock:(id<TWMessageBarClock>)clock
+{
+    if (self.announcementTimer)
+    {
+        [_clock cancelScheduledBlock:self.announcementTimer];
+        self.announcementTimer = nil;
+    }
+    
+    // Tokens only mean something to the clock that issued them; visible bars keep their remaining time
+    NSMutableArray *rearmedMessageViews = [NSMutableArray array];
+    NSMutableArray *remainingDelays = [NSMutableArray array];
+    for (TWMessageView *messageView in self.visibleMessageViews)
+    {
+        if (messageView.dismissTimer)
+        {
+            [rearmedMessageViews addObject:messageView];
+            [remainingDelays addObject:@(MAX(messageView.dismissTime - [_clock currentTime], 0.0))];
+            [self cancelDismissalOfMessageView:messageView];
+        }
+    }
+    
+    _clock = clock ? clock : [[TWMessageBarSystemClock alloc] init];
+    
+    for (NSUInteger i = 0; i < [rearmedMessageViews count]; i++)
+    {
+        [self scheduleDismissalOfMessageView:[rearmedMessageViews objectAtIndex:i] afterDelay:[[remainingDelays objectAtIndex:i] doubleValue]];
+    }
+    self.animator.clock = [_clock isKindOfClass:[TWMessageBarSystemClock class]] ? nil : _clock;
+    
+    // Timestamps from the previous clock are meaningless; re-arm any pending announcement on the new one
+    self.lastAnnouncementTime = 0.0;
+    if ([self.pendingAnnouncements count] > 0)
+    {
+        TWMessageView *messageView = [self.pendingAnnouncements lastObject];
+        [self.pendingAnnouncements removeLastObject];
+        [self announceMessageView:messageView];
+    }
+}
+
+- (void)setMaximumVisibleMessages:(NSUInteger)maximumVisibleMessages
+{
+    _maximumVisibleMessages = maximumVisibleMessages;
+    [self showNextMessage]; // fill any newly freed slots
+}
+
+- (void)setStackStyle:(TWMessageBarStackStyle)stackStyle
+{
+    _stackStyle = stackStyle;
+    [self layoutVisibleMessageViewsFromIndex:0];
+}
+
+- (void)setStyleSheet:(NSObject<TWMessageBarStyleSheet> *)styleSheet
+{
+    if (styleSheet != nil)
+    {
+        _styleSheet = styleSheet;
+        for (NSUInteger type = 0; type < TW_MESSAGE_TYPE_CAPACITY; type++)
+        {
+            _styleAttributes[type] = nil; // rebuilt lazily against the new style sheet
+        }
+        for (NSUInteger i = 0; i < _queue.count; i++)
+        {
+            [self queuedMessageAtIndex:i].clamped = NO; // re-clamped against the new caps when presented
+        }
+        [self.visibleMessageViews makeObjectsPerformSelector:@selector(invalidateTextLayouts)];
+    }
+}
+
+#pragma mark - TWMessageViewDelegate
+
+- (NSObject<TWMessageBarStyleSheet> *)styleSheetForMessageView:(TWMessageView *)messageView
+{
+    return self.styleSheet;
+}
+
+- (TWMessageBarStyleAttributes *)styleAttributesForMessageView:(TWMessageView *)messageView
+{
+    return [self styleAttributesForMessageType:messageView.messageType];
+}
+
+- (void)messageViewDidChangeHeight:(TWMessageView *)messageView
+{
+    NSUInteger index = [self.visibleMessageViews indexOfObjectIdenticalTo:messageView];
+    if (index != NSNotFound)
+    {
+        [self layoutVisibleMessageViewsFromIndex:index];
+    }
+}
+
+#pragma mark - UIAccessibilityContainer
+
+- (NSInteger)accessibilityElementCount
+{
+    return (NSInteger)[self.accessibleElements count];
+}
+
+- (id)accessibilityElementAtIndex:(NSInteger)index
+{
+    return [self.accessibleElements objectAtIndex:(NSUInteger)index];
+}
+
+- (NSInteger)indexOfAccessibilityElement:(id)element
+{
+    return (NSInteger)[self.accessibleElements indexOfObject:element];
+}
+
+- (BOOL)isAccessibilityElement
+{
+    return NO;
+}
+
+@end
+
+@implementation TWMessageBarMessage
+
+#pragma mark - Alloc/Init
+
++ (nonnull instancetype)messageWithTitle:(nullable NSString *)title description:(nullable NSString *)description type:(TWMessageBarMessageType)type
+{
+    TWMessageBarMessage *message = [[self alloc] init];
+    message.title = title;
+    message.messageDescription = description;
+    message.type = type;
+    return message;
+}
+
+#pragma mark - Setters
+
+- (void)setDuration:(CGFloat)duration
+{
+    _duration = duration;
+    _overrides |= TWMessageBarMessageOverrideDuration;
+}
+
+- (void)setStatusBarStyle:(UIStatusBarStyle)statusBarStyle
+{
+    _statusBarStyle = statusBarStyle;
+    _overrides |= TWMessageBarMessageOverrideStatusBarStyle;
+}
+
+- (void)setStatusBarHidden:(BOOL)statusBarHidden
+{
+    _statusBarHidden = statusBarHidden;
+    _overrides |= TWMessageBarMessageOverrideStatusBarHidden;
+}
+
+#pragma mark - NSCopying
+
+- (id)copyWithZone:(NSZone *)zone
+{
+    // Public values only; a copy has yet to be queued
+    TWMessageBarMessage *message = [[[self class] allocWithZone:zone] init];
+    message->_title = [_title copy];
+    message->_messageDescription = [_messageDescription copy];
+    message->_type = _type;
+    message->_duration = _duration;
+    message->_statusBarStyle = _statusBarStyle;
+    message->_statusBarHidden = _statusBarHidden;
+    message->_callback = [_callback copy];
+    message->_overrides = _overrides;
+    return message;
+}
+
+@end
+
+@implementation TWMessageBarStyleAttributes
+
+#pragma mark - Alloc/Init
+
++ (void)initialize
+{
+	if (self == [TWMessageBarStyleAttributes class])
+	{
+        // Fonts
+        kTWMessageViewTitleFont = [UIFont boldSystemFontOfSize:16.0];
+        kTWMessageViewDescriptionFont = [UIFont systemFontOfSize:14.0];
+        
+        // Colors
+        kTWMessageViewTitleColor = [UIColor colorWithWhite:1.0 alpha:1.0];
+        kTWMessageViewDescriptionColor = [UIColor colorWithWhite:1.0 alpha:1.0];
+        
+        // Paragraph styles
+        NSMutableParagraphStyle *paragraphStyle = [[NSParagraphStyle defaultParagraphStyle] mutableCopy];
+        paragraphStyle.alignment = NSTextAlignmentLeft;
+        kTWMessageViewParagraphStyle = [paragraphStyle copy];
+	}
+}
+
+- (id)initWithStyleSheet:(NSObject<TWMessageBarStyleSheet> *)styleSheet type:(TWMessageBarMessageType)type maximumNumberOfLines:(NSUInteger)maximumNumberOfLines
+{
+    self = [super init];
+    if (self)
+    {
+        _titleFont = [styleSheet respondsToSelector:@selector(titleFontForMessageType:)] ? [styleSheet titleFontForMessageType:type] : kTWMessageViewTitleFont;
+        _descriptionFont = [styleSheet respondsToSelector:@selector(descriptionFontForMessageType:)] ? [styleSheet descriptionFontForMessageType:type] : kTWMessageViewDescriptionFont;
+        _titleColor = [styleSheet respondsToSelector:@selector(titleColorForMessageType:)] ? [styleSheet titleColorForMessageType:type] : kTWMessageViewTitleColor;
+        _descriptionColor = [styleSheet respondsToSelector:@selector(descriptionColorForMessageType:)] ? [styleSheet descriptionColorForMessageType:type] : kTWMessageViewDescriptionColor;
+        
+        _titleAttributes = @{NSFontAttributeName:_titleFont, NSForegroundColorAttributeName:_titleColor, NSParagraphStyleAttributeName:kTWMessageViewParagraphStyle};
+        _descriptionAttributes = @{NSFontAttributeName:_descriptionFont, NSForegroundColorAttributeName:_descriptionColor, NSParagraphStyleAttributeName:kTWMessageViewParagraphStyle};
+        
+        // Caps; 0 (or no answer) falls back to the hard text bounds
+        NSUInteger titleLines = [styleSheet respondsToSelector:@selector(titleMaximumNumberOfLinesForMessageType:)] ? [styleSheet titleMaximumNumberOfLinesForMessageType:type] : 0;
+        NSUInteger descriptionLines = [styleSheet respondsToSelector:@selector(descriptionMaximumNumberOfLinesForMessageType:)] ? [styleSheet descriptionMaximumNumberOfLinesForMessageType:type] : 0;
+        NSUInteger titleLength = [styleSheet respondsToSelector:@selector(titleMaximumLengthForMessageType:)] ? [styleSheet titleMaximumLengthForMessageType:type] : 0;
+        NSUInteger descriptionLength = [styleSheet respondsToSelector:@selector(descriptionMaximumLengthForMessageType:)] ? [styleSheet descriptionMaximumLengthForMessageType:type] : 0;
+        _titleMaximumNumberOfLines = titleLines > 0 ? MIN(titleLines, TW_TEXT_MAXIMUM_LINES) : TW_TEXT_MAXIMUM_LINES;
+        _descriptionMaximumNumberOfLines = descriptionLines > 0 ? MIN(descriptionLines, TW_TEXT_MAXIMUM_LINES) : TW_TEXT_MAXIMUM_LINES;
+        if (maximumNumberOfLines > 0)
+        {
+            _titleMaximumNumberOfLines = MIN(_titleMaximumNumberOfLines, maximumNumberOfLines); // message policy cap
+            _descriptionMaximumNumberOfLines = MIN(_descriptionMaximumNumberOfLines, maximumNumberOfLines);
+        }
+        _titleMaximumLength = titleLength > 0 ? MIN(titleLength, TW_TEXT_MAXIMUM_CHARACTERS) : TW_TEXT_MAXIMUM_CHARACTERS;
+        _descriptionMaximumLength = descriptionLength > 0 ? MIN(descriptionLength, TW_TEXT_MAXIMUM_CHARACTERS) : TW_TEXT_MAXIMUM_CHARACTERS;
+        
+        // Opacity; inferred from the background when the style sheet doesn't say
+        _backgroundColor = [styleSheet respondsToSelector:@selector(backgroundColorForMessageType:)] ? [styleSheet backgroundColorForMessageType:type] : nil;
+        if ([styleSheet respondsToSelector:@selector(isOpaqueForMessageType:)])
+        {
+            _opaque = [styleSheet isOpaqueForMessageType:type] && _backgroundColor != nil;
+        }
+        else
+        {
+            _opaque = _backgroundColor != nil && CGColorGetAlpha(_backgroundColor.CGColor) >= 1.0;
+        }
+        _backgroundBlurRadius = [styleSheet respondsToSelector:@selector(backgroundBlurRadiusForMessageType:)] ? MAX([styleSheet backgroundBlurRadiusForMessageType:type], 0.0) : 0.0;
+        _strokeColor = [styleSheet respondsToSelector:@selector(strokeColorForMessageType:)] ? [styleSheet strokeColorForMessageType:type] : nil;
+        _iconImage = [styleSheet respondsToSelector:@selector(iconImageForMessageType:)] ? [styleSheet iconImageForMessageType:type] : nil;
+        
+        kTWMessageBarStyleAttributesAllocationCount++;
+    }
+    return self;
+}
+
+@end
+
+@implementation TWMessageView
+
+#pragma mark - Alloc/Init
+
+- (id)initWithTitle:(NSString *)title description:(NSString *)description type:(TWMessageBarMessageType)type
+{
+    self = [super initWithFrame:CGRectZero];
+    if (self)
+    {
+        self.backgroundColor = [UIColor clearColor];
+        self.clipsToBounds = NO;
+        self.userInteractionEnabled = YES;
+        
+        _titleString = title;
+        _descriptionString = description;
+        _messageType = type;
+        
+        _hasCallback = NO;
+        _hit = NO;
+        _traceEvent = kTWMessageViewTraceEventNone;
+        
+        // Fill, stroke and icon are layer properties, so the backing store only ever holds text
+        _strokeLayer = [CALayer layer];
+        [self.layer addSublayer:_strokeLayer];
+        _iconLayer = [CALayer layer];
+        [self.layer addSublayer:_iconLayer];
+        
+        // Bar colors are sRGB; keep wide-gamut screens from allocating 64-bit pixels (iOS 12 picks the format itself)
+        if ([self.layer respondsToSelector:@selector(setContentsFormat:)] && !TWMessageViewChoosesBackingStoreFormat())
+        {
+            self.layer.contentsFormat = kCAContentsFormatRGBA8Uint;
+        }
+        
+        [[NSNotificationCenter defaultCenter] addObserver:self selector:@selector(didChangeDeviceOrientation:) name:UIDeviceOrientationDidChangeNotification object:nil];
+    }
+    return self;
+}
+
+#pragma mark - Text
+
++ (NSString *)clampedString:(NSString *)string maximumCharacters:(NSUInteger)maximumCharacters maximumLines:(NSUInteger)maximumLines scan:(TWMessageBarTextScan *)scan
+{
+    NSUInteger length = [string length];
+    maximumCharacters = MIN(maximumCharacters, TW_TEXT_MAXIMUM_CHARACTERS);
+    
+    // Only the prefix that can survive the caps is copied out and scanned
+    unichar characters[TW_TEXT_MAXIMUM_CHARACTERS];
+    [string getCharacters:characters range:NSMakeRange(0, MIN(length, maximumCharacters))];
+    TWMessageBarTextMeasurement measurement = TWMessageBarTextMeasure(characters, length, maximumCharacters, maximumLines);
+    NSUInteger clampedLength = measurement.length;
+    TWMessageBarTextScan textScan = measurement.scan;
+    
+    /*
+     * Don't leave half a grapheme (combining marks, joiners, variation selectors, emoji sequences) at the cut.
+     * What matters is the first unit past it: an ASCII prefix still loses its accent to "e\u0301" cut after the e.
+     * Everything that can extend a grapheme is at or above U+0300.
+     */
+    if (clampedLength < length && clampedLength > 0 && [string characterAtIndex:clampedLength] >= 0x0300)
+    {
+        clampedLength = [string rangeOfComposedCharacterSequenceAtIndex:clampedLength].location;
+        textScan = TWMessageBarTextScanCharacters(characters, clampedLength);
+    }
+    
+    if (scan)
+    {
+        *scan = textScan;
+    }
+    return clampedLength == length ? string : [string substringToIndex:clampedLength];
+}
+
+- (void)updateTitle:(NSString *)title description:(NSString *)description
+{
+    CGRect previousTextRect = CGRectUnion([self titleRect], [self descriptionRect]);
+    
+    TWMessageBarStyleAttributes *styleAttributes = [self styleAttributes];
+    TWMessageBarTextScan titleScan, descriptionScan;
+    self.titleString = [TWMessageView clampedString:title maximumCharacters:styleAttributes.titleMaximumLength maximumLines:styleAttributes.titleMaximumNumberOfLines scan:&titleScan];
+    self.descriptionString = [TWMessageView clampedString:description maximumCharacters:styleAttributes.descriptionMaximumLength maximumLines:styleAttributes.descriptionMaximumNumberOfLines scan:&descriptionScan];
+    self.titleScan = titleScan;
+    self.descriptionScan = descriptionScan;
+    _textLayouts.count = 0;
+    
+    if (self.superview == nil)
+    {
+        return; // drawn in full when presented
+    }
+    
+    CGFloat height = [self height];
+    if (height != self.bounds.size.height)
+    {
+        // A new height moves the stroke and the bars below; repaint everything
+        self.frame = CGRectMake(self.frame.origin.x, self.frame.origin.y, self.frame.size.width, height);
+        [self setNeedsDisplay];
+        if ([self.delegate respondsToSelector:@selector(messageViewDidChangeHeight:)])
+        {
+            [self.delegate messageViewDidChangeHeight:self];
+        }
+        return;
+    }
+    
+    // Only the old and new text need repainting; the fill, stroke and icon are untouched
+    [self setNeedsDisplayInRect:CGRectUnion(previousTextRect, CGRectUnion([self titleRect], [self descriptionRect]))];
+}
+
+#pragma mark - Memory Management
+
+- (void)dealloc
+{
+    [[NSNotificationCenter defaultCenter] removeObserver:self name:UIDeviceOrientationDidChangeNotification object:nil];
+}
+
+#pragma mark - Background
+
+- (void)captureBackground
+{
+    CGFloat blurRadius = [self styleAttributes].backgroundBlurRadius;
+    UIWindow *keyWindow = [UIApplication sharedApplication].keyWindow;
+    self.backgroundImage = nil;
+    if (blurRadius <= 0.0 || keyWindow == nil || self.superview == nil || ![keyWindow respondsToSelector:@selector(drawViewHierarchyInRect:afterScreenUpdates:)])
+    {
+        [self updateLayers];
+        return;
+    }
+    
+    // The app content where the bar comes to rest, downsampled; dimensions round up to whole blur blocks
+    CGRect restingFrame = CGRectMake(0.0, self.restingOffset, self.bounds.size.width, self.bounds.size.height);
+    CGRect snapshotRect = [keyWindow convertRect:restingFrame fromView:self.superview];
+    size_t width = (size_t)ceil(snapshotRect.size.width / (kTWMessageViewBlurDownsampling * TW_BLUR_BLOCK_PIXELS)) * TW_BLUR_BLOCK_PIXELS;
+    size_t height = (size_t)ceil(snapshotRect.size.height / (kTWMessageViewBlurDownsampling * TW_BLUR_BLOCK_PIXELS)) * TW_BLUR_BLOCK_PIXELS;
+    uint8_t *pixels = width > 0 && height > 0 ? calloc(width * height, 4) : NULL;
+    void *scratch = NULL;
+    if (pixels == NULL || posix_memalign(&scratch, 64, TWMessageBarBoxBlurScratchSize(width, height)) != 0)
+    {
+        free(pixels);
+        [self updateLayers];
+        return;
+    }
+    
+    CGColorSpaceRef colorSpace = CGColorSpaceCreateDeviceRGB();
+    CGBitmapInfo bitmapInfo = (CGBitmapInfo)kCGImageAlphaPremultipliedLast | kCGBitmapByteOrder32Big;
+    CGContextRef context = CGBitmapContextCreate(pixels, width, height, 8, width * 4, colorSpace, bitmapInfo);
+    
+    // Flip to UIKit coordinates and map the snapshot rect onto the bitmap
+    CGContextTranslateCTM(context, 0.0, height);
+    CGContextScaleCTM(context, width / snapshotRect.size.width, -(height / snapshotRect.size.height));
+    CGContextTranslateCTM(context, -snapshotRect.origin.x, -snapshotRect.origin.y);
+    CGContextSetInterpolationQuality(context, kCGInterpolationLow);
+    UIGraphicsPushContext(context);
+    [keyWindow drawViewHierarchyInRect:keyWindow.bounds afterScreenUpdates:NO];
+    UIGraphicsPopContext();
+    CGContextRelease(context);
+    
+    TWMessageBarBoxBlur(pixels, width, height, (size_t)ceil(blurRadius / kTWMessageViewBlurDownsampling), scratch);
+    free(scratch);
+    
+    // The image takes ownership of the pixels
+    CGDataProviderRef dataProvider = CGDataProviderCreateWithData(NULL, pixels, width * height * 4, TWMessageBarReleasePixels);
+    CGImageRef image = CGImageCreate(width, height, 8, 32, width * 4, colorSpace, bitmapInfo, dataProvider, NULL, false, kCGRenderingIntentDefault);
+    CGDataProviderRelease(dataProvider);
+    CGColorSpaceRelease(colorSpace);
+    self.backgroundImage = [UIImage imageWithCGImage:image];
+    CGImageRelease(image);
+    
+    [self updateLayers];
+    [self setNeedsDisplay];
+}
+
+#pragma mark - Backing Store
+
+- (void)releaseBackingStore
+{
+    // Offscreen bars keep only their layer properties; text and snapshot come back when they do
+    self.backingStoreReleased = YES;
+    self.layer.contents = nil;
+    if (self.backgroundImage)
+    {
+        self.backgroundImage = nil;
+        [self updateLayers];
+    }
+}
+
+- (void)restoreBackingStore
+{
+    if (![self isBackingStoreReleased])
+    {
+        return;
+    }
+    self.backingStoreReleased = NO;
+    if ([self styleAttributes].backgroundBlurRadius > 0.0)
+    {
+        [self captureBackground];
+    }
+    [self setNeedsDisplay];
+}
+
+- (NSUInteger)backingStoreBytes
+{
+    // Estimated at 4 bytes per pixel; UIKit may pick a smaller format on iOS 12 and later
+    NSUInteger bytes = 0;
+    if (self.layer.contents != nil)
+    {
+        CGFloat scale = self.layer.contentsScale;
+        bytes += (NSUInteger)(ceil(self.bounds.size.width * scale) * ceil(self.bounds.size.height * scale)) * 4;
+    }
+    if (self.backgroundImage)
+    {
+        CGImageRef image = self.backgroundImage.CGImage;
+        bytes += CGImageGetBytesPerRow(image) * CGImageGetHeight(image);
+    }
+    return bytes;
+}
+
+#pragma mark - Layout
+
+- (void)layoutSubviews
+{
+    [super layoutSubviews];
+    
+    // The stroke is the inner half of a 1pt line along the bottom edge, as it was when drawn
+    [CATransaction begin];
+    [CATransaction setDisableActions:YES];
+    self.strokeLayer.frame = CGRectMake(0.0, self.bounds.size.height - 0.5, self.bounds.size.width, 0.5);
+    self.iconLayer.frame = [self iconRect];
+    [CATransaction commit];
+}
+
+#pragma mark - Drawing
+
+- (void)drawRect:(CGRect)rect
+{
+    TWMessageBarTrace(TWMessageBarTraceEventDraw, TWMessageBarTracePhaseBegin, self.messageIdentifier);
+    
+    // Geometry comes from the bounds; rect is only the dirty region, and anything outside it is skipped
+    CGContextRef context = UIGraphicsGetCurrentContext();
+    CGRect bounds = self.bounds;
+    
+    if ([self.delegate respondsToSelector:@selector(styleAttributesForMessageView:)])
+    {
+        // Resolved once per type and style sheet; nothing here goes back to the style sheet
+        TWMessageBarStyleAttributes *styleAttributes = [self styleAttributes];
+        
+        // blurred snapshot, tinted by the background fill; opaque bars also fill, since nothing clears their backing store
+        if (self.backgroundImage)
+        {
+            [self.backgroundImage drawInRect:bounds];
+        }
+        if (self.backgroundImage || self.opaque)
+        {
+            CGContextSaveGState(context);
+            {
+                if (styleAttributes.backgroundColor)
+                {
+                    [styleAttributes.backgroundColor set];
+                    CGContextFillRect(context, CGRectIntersection(rect, bounds));
+                }
+            }
+            CGContextRestoreGState(context);
+        }
+        
+        // stroke and icon are sublayers (see updateLayers)
+        
+        CGRect titleRect = [self titleRect];
+        CGRect descriptionRect = [self descriptionRect];
+        BOOL drawsTitle = CGRectIntersectsRect(rect, titleRect);
+        BOOL drawsDescription = CGRectIntersectsRect(rect, descriptionRect);
+        
+        if ([[UIDevice currentDevice] tw_isRunningiOS7OrLater])
+        {
+            if (drawsTitle)
+            {
+                [styleAttributes.titleColor set];
+                [self.titleString drawWithRect:titleRect
+                                       options:NSStringDrawingUsesLineFragmentOrigin | NSStringDrawingTruncatesLastVisibleLine
+                                    attributes:styleAttributes.titleAttributes
+                                       context:nil];
+            }
+            
+            if (drawsDescription)
+            {
+                [styleAttributes.descriptionColor set];
+                [self.descriptionString drawWithRect:descriptionRect
+                                             options:NSStringDrawingUsesLineFragmentOrigin | NSStringDrawingTruncatesLastVisibleLine
+                                          attributes:styleAttributes.descriptionAttributes
+                                             context:nil];
+            }
+        }
+        else
+        {
+            if (drawsTitle)
+            {
+                [styleAttributes.titleColor set];
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wdeprecated-declarations"
+                [self.titleString drawInRect:titleRect withFont:styleAttributes.titleFont lineBreakMode:NSLineBreakByTruncatingTail alignment:NSTextAlignmentLeft];
+#pragma clang diagnostic pop
+            }
+            
+            if (drawsDescription)
+            {
+                [styleAttributes.descriptionColor set];
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wdeprecated-declarations"
+                [self.descriptionString drawInRect:descriptionRect withFont:styleAttributes.descriptionFont lineBreakMode:NSLineBreakByTruncatingTail alignment:NSTextAlignmentLeft];
+#pragma clang diagnostic pop
+            }
+        }
+    }
+    
+    TWMessageBarTrace(TWMessageBarTraceEventDraw, TWMessageBarTracePhaseEnd, self.messageIdentifier);
+}
+
+#pragma mark - Getters
+
+- (CGFloat)height
+{
+    CGSize titleLabelSize = [self titleSize];
+    CGSize descriptionLabelSize = [self descriptionSize];
+    return MAX((kTWMessageViewBarPadding * 2) + titleLabelSize.height + descriptionLabelSize.height + [self statusBarOffset], (kTWMessageViewBarPadding * 2) + kTWMessageViewIconSize + [self statusBarOffset]);
+}
+
+- (CGFloat)width
+{
+    return [self statusBarFrame].size.width;
+}
+
+- (CGFloat)statusBarOffset
+{
+    return [[UIDevice currentDevice] tw_isRunningiOS7OrLater] ? [self statusBarFrame].size.height : 0.0;
+}
+
+- (CGFloat)availableWidth
+{
+    return ([self width] - (kTWMessageViewBarPadding * 3) - kTWMessageViewIconSize);
+}
+
+- (CGSize)titleSize
+{
+    TWMessageBarTextLayout textLayout = [self textLayout];
+    return CGSizeMake((CGFloat)textLayout.titleWidth, (CGFloat)textLayout.titleHeight);
+}
+
+- (CGSize)descriptionSize
+{
+    TWMessageBarTextLayout textLayout = [self textLayout];
+    return CGSizeMake((CGFloat)textLayout.descriptionWidth, (CGFloat)textLayout.descriptionHeight);
+}
+
+- (CGRect)iconRect
+{
+    return CGRectMake(kTWMessageViewBarPadding, kTWMessageViewBarPadding + [self statusBarOffset], kTWMessageViewIconSize, kTWMessageViewIconSize);
+}
+
+- (CGRect)titleRect
+{
+    CGSize titleLabelSize = [self titleSize];
+    CGFloat xOffset = (kTWMessageViewBarPadding * 2) + kTWMessageViewIconSize;
+    CGFloat yOffset = kTWMessageViewBarPadding + [self statusBarOffset] - kTWMessageViewTextOffset;
+    if (self.titleString && !self.descriptionString)
+    {
+        yOffset = ceil(self.bounds.size.height * 0.5) - ceil(titleLabelSize.height * 0.5) - kTWMessageViewTextOffset; // centered
+    }
+    return CGRectMake(xOffset, yOffset, titleLabelSize.width, titleLabelSize.height);
+}
+
+- (CGRect)descriptionRect
+{
+    CGRect titleRect = [self titleRect];
+    CGSize descriptionLabelSize = [self descriptionSize];
+    return CGRectMake(titleRect.origin.x, CGRectGetMaxY(titleRect), descriptionLabelSize.width, descriptionLabelSize.height);
+}
+
+- (TWMessageBarTextLayout)textLayout
+{
+    UIWindow *keyWindow = [UIApplication sharedApplication].keyWindow;
+    CGRect windowFrame = NSFoundationVersionNumber <= NSFoundationVersionNumber_iOS_7_1 ? [self orientFrame:keyWindow.frame] : keyWindow.frame;
+    return [self textLayoutForWindowSize:windowFrame.size];
+}
+
+- (TWMessageBarTextLayout)textLayoutForWindowSize:(CGSize)windowSize
+{
+    CGFloat availableWidth = windowSize.width - (kTWMessageViewBarPadding * 3) - kTWMessageViewIconSize;
+    CGFloat maximumTextHeight = [self maximumTextHeightForWindowHeight:windowSize.height];
+    const TWMessageBarTextLayout *cachedTextLayout = TWMessageBarTextLayoutCacheLookup(&_textLayouts, availableWidth, maximumTextHeight);
+    if (cachedTextLayout != NULL)
+    {
+        return *cachedTextLayout;
+    }
+    
+    CGSize titleSize = [self titleSizeForAvailableWidth:availableWidth maximumTextHeight:maximumTextHeight];
+    CGSize descriptionSize = [self descriptionSizeForAvailableWidth:availableWidth maximumTextHeight:MAX(maximumTextHeight - titleSize.height, 0.0)];
+    TWMessageBarTextLayout textLayout = {availableWidth, maximumTextHeight, titleSize.width, titleSize.height, descriptionSize.width, descriptionSize.height};
+    BOOL firstLayout = _textLayouts.count == 0;
+    TWMessageBarTextLayoutCacheInsert(&_textLayouts, &textLayout);
+    
+    // Measure the other orientation up front so rotating is a lookup
+    if (firstLayout && windowSize.width != windowSize.height)
+    {
+        [self textLayoutForWindowSize:CGSizeMake(windowSize.height, windowSize.width)];
+    }
+    return textLayout;
+}
+
+- (CGSize)titleSizeForAvailableWidth:(CGFloat)availableWidth maximumTextHeight:(CGFloat)maximumTextHeight
+{
+    TWMessageBarStyleAttributes *styleAttributes = [self styleAttributes];
+    CGSize boundedSize = CGSizeMake(availableWidth, TWMessageBarTextBoundedHeight(styleAttributes.titleMaximumNumberOfLines, styleAttributes.titleFont.lineHeight, maximumTextHeight));
+    CGSize titleLabelSize;
+    
+    if ([self measureSingleLineString:self.titleString scan:self.titleScan attributes:styleAttributes.titleAttributes boundedSize:boundedSize size:&titleLabelSize])
+    {
+        // measured from cached glyph advances
+    }
+    else if ([[UIDevice currentDevice] tw_isRunningiOS7OrLater])
+    {
+        titleLabelSize = [self.titleString boundingRectWithSize:boundedSize
+                                                        options:NSStringDrawingTruncatesLastVisibleLine | NSStringDrawingUsesLineFragmentOrigin
+                                                     attributes:styleAttributes.titleAttributes
+                                                        context:nil].size;
+    }
+    else
+    {
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wdeprecated-declarations"
+        titleLabelSize = [_titleString sizeWithFont:[self titleFont] constrainedToSize:boundedSize lineBreakMode:NSLineBreakByTruncatingTail];
+#pragma clang diagnostic pop
+    }
+    
+    return CGSizeMake(ceilf(titleLabelSize.width), ceilf(titleLabelSize.height));
+}
+
+- (CGSize)descriptionSizeForAvailableWidth:(CGFloat)availableWidth maximumTextHeight:(CGFloat)maximumTextHeight
+{
+    TWMessageBarStyleAttributes *styleAttributes = [self styleAttributes];
+    CGSize boundedSize = CGSizeMake(availableWidth, TWMessageBarTextBoundedHeight(styleAttributes.descriptionMaximumNumberOfLines, styleAttributes.descriptionFont.lineHeight, maximumTextHeight));
+    CGSize descriptionLabelSize;
+    
+    if ([self measureSingleLineString:self.descriptionString scan:self.descriptionScan attributes:styleAttributes.descriptionAttributes boundedSize:boundedSize size:&descriptionLabelSize])
+    {
+        // measured from cached glyph advances
+    }
+    else if ([[UIDevice currentDevice] tw_isRunningiOS7OrLater])
+    {
+        descriptionLabelSize = [self.descriptionString boundingRectWithSize:boundedSize
+                                                                    options:NSStringDrawingTruncatesLastVisibleLine | NSStringDrawingUsesLineFragmentOrigin
+                                                                 attributes:styleAttributes.descriptionAttributes
+                                                                    context:nil].size;
+    }
+    else
+    {
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wdeprecated-declarations"
+        descriptionLabelSize = [_descriptionString sizeWithFont:[self descriptionFont] constrainedToSize:boundedSize lineBreakMode:NSLineBreakByTruncatingTail];
+#pragma clang diagnostic pop
+    }
+    
+    return CGSizeMake(ceilf(descriptionLabelSize.width), ceilf(descriptionLabelSize.height));
+}
+
+/*
+ * Short single-line ASCII strings are measured by summing cached glyph advances instead of running the text system.
+ * Anything with newlines, non-ASCII or kerned pairs, or that would wrap or truncate, returns NO and takes the full path.
+ */
+- (BOOL)measureSingleLineString:(NSString *)string scan:(TWMessageBarTextScan)scan attributes:(NSDictionary *)attributes boundedSize:(CGSize)boundedSize size:(CGSize *)size
+{
+    NSUInteger length = [string length];
+    if (length == 0 || length > TW_TEXT_MAXIMUM_CHARACTERS || !scan.asciiOnly || scan.newlineCount > 0 || ![[UIDevice currentDevice] tw_isRunningiOS7OrLater])
+    {
+        return NO;
+    }
+    
+    TWMessageBarGlyphAdvanceTable *advanceTable = [TWMessageBarGlyphAdvanceTable tableForFont:[attributes objectForKey:NSFontAttributeName]];
+    if (advanceTable.lineHeight > boundedSize.height)
+    {
+        return NO;
+    }
+    
+    unichar characters[TW_TEXT_MAXIMUM_CHARACTERS];
+    [string getCharacters:characters range:NSMakeRange(0, length)];
+    CGFloat width = 0.0;
+    if (![advanceTable measureCharacters:characters length:length width:&width] || width > boundedSize.width)
+    {
+        return NO;
+    }
+    
+    *size = CGSizeMake(ceilf(width), ceilf(advanceTable.lineHeight));
+    return YES;
+}
+
+/*
+ * Depends on the window size alone: the status bar height changes with orientation (and is gone in landscape on
+ * iPhone), so leaving it out keeps the layout cache key stable across rotation.
+ */
+- (CGFloat)maximumTextHeightForWindowHeight:(CGFloat)windowHeight
+{
+    return TWMessageBarTextMaximumHeight(windowHeight, kTWMessageViewMaximumHeightRatio, kTWMessageViewBarPadding, kTWMessageViewIconSize);
+}
+
+- (CGRect)statusBarFrame
+{
+    CGRect windowFrame = NSFoundationVersionNumber <= NSFoundationVersionNumber_iOS_7_1 ? [self orientFrame:[UIApplication sharedApplication].keyWindow.frame] : [UIApplication sharedApplication].keyWindow.frame;
+    CGRect statusFrame = NSFoundationVersionNumber <= NSFoundationVersionNumber_iOS_7_1 ?  [self orientFrame:[UIApplication sharedApplication].statusBarFrame] : [UIApplication sharedApplication].statusBarFrame;
+    return CGRectMake(windowFrame.origin.x, windowFrame.origin.y, windowFrame.size.width, statusFrame.size.height);
+}
+
+- (TWMessageBarStyleAttributes *)styleAttributes
+{
+    if ([self.delegate respondsToSelector:@selector(styleAttributesForMessageView:)])
+    {
+        return [self.delegate styleAttributesForMessageView:self];
+    }
+    return [[TWMessageBarStyleAttributes alloc] initWithStyleSheet:nil type:self.messageType maximumNumberOfLines:0];
+}
+
+- (UIFont *)titleFont
+{
+    return [self styleAttributes].titleFont;
+}
+
+- (UIFont *)descriptionFont
+{
+    return [self styleAttributes].descriptionFont;
+}
+
+- (UIColor *)titleColor
+{
+    return [self styleAttributes].titleColor;
+}
+
+- (UIColor *)descriptionColor
+{
+    return [self styleAttributes].descriptionColor;
+}
+
+#pragma mark - Helpers
+
+- (CGRect)orientFrame:(CGRect)frame
+{
+    return frame;
+}
+
+- (void)invalidateTextLayouts
+{
+    _textLayouts.count = 0;
+    [self updateLayers];
+    [self setNeedsDisplay];
+}
+
+- (void)updateLayers
+{
+    // An opaque bar covers its whole frame, so the compositor can skip blending it over the app beneath
+    TWMessageBarStyleAttributes *styleAttributes = [self styleAttributes];
+    self.opaque = styleAttributes.isOpaque || self.backgroundImage != nil;
+    self.clipsToBounds = self.opaque;
+    
+    // A blurred snapshot has to sit under the tint, so both are drawn; otherwise the fill is the layer's own color
+    self.backgroundColor = self.backgroundImage ? [UIColor clearColor] : styleAttributes.backgroundColor;
+    
+    [CATransaction begin];
+    [CATransaction setDisableActions:YES];
+    self.strokeLayer.backgroundColor = styleAttributes.strokeColor.CGColor;
+    self.iconLayer.contents = (id)styleAttributes.iconImage.CGImage; // shared with every bar of this type
+    self.iconLayer.contentsScale = styleAttributes.iconImage ? styleAttributes.iconImage.scale : 1.0;
+    [CATransaction commit];
+    [self setNeedsLayout];
+}
+
+- (void)traceLifecycleEvent:(NSInteger)event
+{
+    // Closes the open lifecycle interval (if any) and opens the next one
+    if (self.traceEvent == event)
+    {
+        return;
+    }
+    if (self.traceEvent != kTWMessageViewTraceEventNone)
+    {
+        TWMessageBarTrace((TWMessageBarTraceEvent)self.traceEvent, TWMessageBarTracePhaseEnd, self.messageIdentifier);
+    }
+    self.traceEvent = event;
+    if (event != kTWMessageViewTraceEventNone)
+    {
+        TWMessageBarTrace((TWMessageBarTraceEvent)event, TWMessageBarTracePhaseBegin, self.messageIdentifier);
+    }
+}
+
+#pragma mark - Notifications
+
+- (void)didChangeDeviceOrientation:(NSNotification *)notification
+{
+    // Both orientations were measured up front; this is a table lookup and a frame change
+    CGFloat height = [self height];
+    BOOL heightChanged = height != self.frame.size.height;
+    self.frame = CGRectMake(self.frame.origin.x, self.frame.origin.y, [self statusBarFrame].size.width, height);
+    if (self.backgroundImage)
+    {
+        [self captureBackground]; // the old snapshot no longer matches what's beneath
+    }
+    [self setNeedsDisplay];
+    
+    if (heightChanged && [self.delegate respondsToSelector:@selector(messageViewDidChangeHeight:)])
+    {
+        [self.delegate messageViewDidChangeHeight:self];
+    }
+}
+
+@end
+
+@implementation TWDefaultMessageBarStyleSheet
+
+#pragma mark - Alloc/Init
+
++ (void)initialize
+{
+	if (self == [TWDefaultMessageBarStyleSheet class])
+	{
+        TWMessageBarMessageTypesInitialize(); // colors and icons live in the type registry
+    }
+}
+
++ (TWDefaultMessageBarStyleSheet *)styleSheet
+{
+    return [[TWDefaultMessageBarStyleSheet alloc] init];
+}
+
++ (TWDefaultMessageBarStyleSheet *)opaqueStyleSheet
+{
+    TWDefaultMessageBarStyleSheet *styleSheet = [[TWDefaultMessageBarStyleSheet alloc] init];
+    styleSheet.opaque = YES;
+    return styleSheet;
+}
+
+#pragma mark - TWMessageBarStyleSheet
+
+- (nonnull UIColor *)backgroundColorForMessageType:(TWMessageBarMessageType)type
+{
+    NSUInteger index = TWMessageBarMessageTypeIndex(type);
+    return self.isOpaque ? kTWDefaultMessageBarStyleSheetOpaqueBackgroundColors[index] : kTWDefaultMessageBarStyleSheetBackgroundColors[index];
+}
+
+- (nonnull UIColor *)strokeColorForMessageType:(TWMessageBarMessageType)type
+{
+    return kTWDefaultMessageBarStyleSheetStrokeColors[TWMessageBarMessageTypeIndex(type)];
+}
+
+- (nonnull UIImage *)iconImageForMessageType:(TWMessageBarMessageType)type
+{
+    return kTWDefaultMessageBarStyleSheetIconImages[TWMessageBarMessageTypeIndex(type)];
+}
+
+@end
+
+@interface TWMessageBarGlyphAdvanceTable ()
+{
+    CGFloat _advances[TW_ADVANCE_TABLE_COUNT];
+    uint8_t _pairStates[TW_ADVANCE_TABLE_COUNT * TW_ADVANCE_TABLE_COUNT]; // TWMessageBarKerningPairState, filled in lazily
+}
+
+@property (nonatomic, copy) NSDictionary *attributes;
+
+// Initializers
+- (id)initWithFont:(UIFont *)font;
+
+// Helpers
+- (BOOL)isKernedPairWithFirstIndex:(NSUInteger)firstIndex secondIndex:(NSUInteger)secondIndex;
+
+@end
+
+@implementation TWMessageBarGlyphAdvanceTable
+
+#pragma mark - Alloc/Init
+
++ (TWMessageBarGlyphAdvanceTable *)tableForFont:(UIFont *)font
+{
+    if (kTWMessageBarGlyphAdvanceTables == nil)
+    {
+        kTWMessageBarGlyphAdvanceTables = [[NSMutableDictionary alloc] init];
+    }
+    
+    TWMessageBarGlyphAdvanceTable *table = [kTWMessageBarGlyphAdvanceTables objectForKey:font];
+    if (table == nil)
+    {
+        table = [[TWMessageBarGlyphAdvanceTable alloc] initWithFont:font];
+        [kTWMessageBarGlyphAdvanceTables setObject:table forKey:font];
+    }
+    return table;
+}
+
+- (id)initWithFont:(UIFont *)font
+{
+    self = [super init];
+    if (self)
+    {
+        _attributes = @{NSFontAttributeName:font};
+        _lineHeight = font.lineHeight;
+        
+        for (NSUInteger index = 0; index < TW_ADVANCE_TABLE_COUNT; index++)
+        {
+            unichar character = (unichar)(TW_ADVANCE_TABLE_FIRST_CHARACTER + index);
+            _advances[index] = [[NSString stringWithCharacters:&character length:1] sizeWithAttributes:_attributes].width;
+        }
+        memset(_pairStates, TWMessageBarKerningPairUnknown, sizeof(_pairStates));
+    }
+    return self;
+}
+
+#pragma mark - Measuring
+
+- (BOOL)measureCharacters:(const unichar *)characters length:(NSUInteger)length width:(CGFloat *)width
+{
+    CGFloat totalWidth = 0.0;
+    NSUInteger previousIndex = NSNotFound;
+    for (NSUInteger i = 0; i < length; i++)
+    {
+        NSUInteger index = (NSUInteger)characters[i] - TW_ADVANCE_TABLE_FIRST_CHARACTER;
+        if (index >= TW_ADVANCE_TABLE_COUNT)
+        {
+            return NO; // control character
+        }
+        if (previousIndex != NSNotFound && [self isKernedPairWithFirstIndex:previousIndex secondIndex:index])
+        {
+            return NO;
+        }
+        totalWidth += _advances[index];
+        previousIndex = index;
+    }
+    *width = totalWidth;
+    return YES;
+}
+
+#pragma mark - Helpers
+
+- (BOOL)isKernedPairWithFirstIndex:(NSUInteger)firstIndex secondIndex:(NSUInteger)secondIndex
+{
+    uint8_t *state = &_pairStates[(firstIndex * TW_ADVANCE_TABLE_COUNT) + secondIndex];
+    if (*state == TWMessageBarKerningPairUnknown)
+    {
+        // Each pair is measured once per font, the first time it shows up
+        unichar pair[2] = {(unichar)(TW_ADVANCE_TABLE_FIRST_CHARACTER + firstIndex), (unichar)(TW_ADVANCE_TABLE_FIRST_CHARACTER + secondIndex)};
+        CGFloat pairWidth = [[NSString stringWithCharacters:pair length:2] sizeWithAttributes:self.attributes].width;
+        BOOL kerned = fabs(pairWidth - (_advances[firstIndex] + _advances[secondIndex])) > kTWMessageBarGlyphAdvanceTableKerningTolerance;
+        *state = kerned ? TWMessageBarKerningPairKerned : TWMessageBarKerningPairPlain;
+    }
+    return *state == TWMessageBarKerningPairKerned;
+}
+
+@end
+
+@implementation TWMessageWindow
+
+#pragma mark - Touches
+
+- (UIView *)hitTest:(CGPoint)point withEvent:(UIEvent *)event
+{
+    UIView *hitView = [super hitTest:point withEvent:event];
+    
+    /*
+     * Pass touches through if they land on the rootViewController's view.
+     * Allows notification interaction without blocking the window below.
+     */
+    if ([hitView isEqual: self.rootViewController.view])
+    {
+        hitView = nil;
+    }
+    
+    return hitView;
+}
+
+@end
+
+@interface TWMessageBarAnimation : NSObject
+
+@property (nonatomic, strong) UIView *view;
+@property (nonatomic, assign) TWMessageBarSpring spring;
+@property (nonatomic, copy) void (^completion)(BOOL finished);
+
+@end
+
+@implementation TWMessageBarAnimation
+
+@end
+
+@interface TWMessageBarAnimator ()
+
+@property (nonatomic, strong) NSMutableArray *animations;
+@property (nonatomic, strong) CADisplayLink *displayLink;
+@property (nonatomic, assign) CFTimeInterval lastTimestamp;
+@property (nonatomic, strong) id clockTimer; // TWMessageBarClock token while ticking on the clock
+
+// Helpers
+- (TWMessageBarAnimation *)animationForView:(UIView *)view;
+- (void)startTicking;
+- (void)stepAnimationsByInterval:(CFTimeInterval)interval;
 
-- (NSInteger)indexOfAccessibilityElement:(id)element
-{
-    return (NSInteger)[self.accessibleElements indexOfObject:element];
-}
+// Display link
+- (void)displayLinkDidFire:(CADisplayLink *)displayLink;
 
-- (BOOL)isAccessibilityElement
-{
-    return NO;
-}
+// Clock
+- (void)scheduleClockTick;
 
 @end
 
-@implementation TWMessageView
+@implementation TWMessageBarAnimator
 
 #pragma mark - Alloc/Init
 
-+ (void)initialize
-{
-	if (self == [TWMessageView class])
-	{
-        // Fonts
-        kTWMessageViewTitleFont = [UIFont boldSystemFontOfSize:16.0];
-        kTWMessageViewDescriptionFont = [UIFont systemFontOfSize:14.0];
-        
-        // Colors
-        kTWMessageViewTitleColor = [UIColor colorWithWhite:1.0 alpha:1.0];
-        kTWMessageViewDescriptionColor = [UIColor colorWithWhite:1.0 alpha:1.0];
-	}
-}
-
-- (id)initWithTitle:(NSString *)title description:(NSString *)description type:(TWMessageBarMessageType)type
+- (id)init
 {
-    self = [super initWithFrame:CGRectZero];
+    self = [super init];
     if (self)
     {
-        self.backgroundColor = [UIColor clearColor];
-        self.clipsToBounds = NO;
-        self.userInteractionEnabled = YES;
-        
-        _titleString = title;
-        _descriptionString = description;
-        _messageType = type;
-        
-        _hasCallback = NO;
-        _hit = NO;
+        _animations = [[NSMutableArray alloc] init];
         
-        [[NSNotificationCenter defaultCenter] addObserver:self selector:@selector(didChangeDeviceOrientation:) name:UIDeviceOrientationDidChangeNotification object:nil];
+        // A single display link steps every bar; it only runs while something is in flight
+        TWMessageBarDisplayLinkTarget *target = [[TWMessageBarDisplayLinkTarget alloc] init];
+        target.animator = self;
+        _displayLink = [CADisplayLink displayLinkWithTarget:target selector:@selector(displayLinkDidFire:)];
+        _displayLink.paused = YES;
+        [_displayLink addToRunLoop:[NSRunLoop mainRunLoop] forMode:NSRunLoopCommonModes];
     }
     return self;
 }
@@ -492,356 +2851,301 @@ static UIColor *kTWDefaultMessageBarStyleSheetInfoStrokeColor = nil;
 
 - (void)dealloc
 {
-    [[NSNotificationCenter defaultCenter] removeObserver:self name:UIDeviceOrientationDidChangeNotification object:nil];
+    [_displayLink invalidate];
 }
 
-#pragma mark - Drawing
+#pragma mark - Animations
 
-- (void)drawRect:(CGRect)rect
+- (void)animateView:(UIView *)view toOffset:(CGFloat)offset completion:(void (^)(BOOL finished))completion
 {
-    CGContextRef context = UIGraphicsGetCurrentContext();
+    TWMessageBarAnimation *animation = [self animationForView:view];
+    [self animateView:view toOffset:offset initialVelocity:(animation ? animation.spring.velocity : 0.0) completion:completion];
+}
+
+- (void)animateView:(UIView *)view toOffset:(CGFloat)offset initialVelocity:(CGFloat)velocity completion:(void (^)(BOOL finished))completion
+{
+    TWMessageBarAnimation *animation = [self animationForView:view];
+    if (animation)
+    {
+        // Retarget in flight; the superseded animation never finishes
+        void (^previousCompletion)(BOOL) = animation.completion;
+        animation.completion = nil;
+        if (previousCompletion)
+        {
+            previousCompletion(NO);
+        }
+    }
+    else
+    {
+        animation = [[TWMessageBarAnimation alloc] init];
+        animation.view = view;
+        [self.animations addObject:animation];
+    }
     
-    if ([self.delegate respondsToSelector:@selector(styleSheetForMessageView:)])
+    animation.spring = TWMessageBarSpringMake(view.frame.origin.y, velocity, offset, kTWMessageBarManagerDismissAnimationDuration);
+    animation.completion = completion;
+    
+    [self startTicking];
+}
+
+- (void)stopAnimatingView:(UIView *)view
+{
+    TWMessageBarAnimation *animation = [self animationForView:view];
+    if (animation)
     {
-        id<TWMessageBarStyleSheet> styleSheet = [self.delegate styleSheetForMessageView:self];
-        
-        // background fill
-        CGContextSaveGState(context);
+        [self.animations removeObjectIdenticalTo:animation];
+        if (animation.completion)
         {
-            if ([styleSheet respondsToSelector:@selector(backgroundColorForMessageType:)])
-            {
-                [[styleSheet backgroundColorForMessageType:self.messageType] set];
-                CGContextFillRect(context, rect);
-            }
+            animation.completion(NO);
         }
-        CGContextRestoreGState(context);
-        
-        // bottom stroke
-        CGContextSaveGState(context);
+    }
+}
+
+#pragma mark - Helpers
+
+- (TWMessageBarAnimation *)animationForView:(UIView *)view
+{
+    for (TWMessageBarAnimation *animation in self.animations)
+    {
+        if (animation.view == view)
         {
-            if ([styleSheet respondsToSelector:@selector(strokeColorForMessageType:)])
-            {
-                CGContextBeginPath(context);
-                CGContextMoveToPoint(context, 0, rect.size.height);
-                CGContextSetStrokeColorWithColor(context, [styleSheet strokeColorForMessageType:self.messageType].CGColor);
-                CGContextSetLineWidth(context, 1.0);
-                CGContextAddLineToPoint(context, rect.size.width, rect.size.height);
-                CGContextStrokePath(context);
-            }
+            return animation;
         }
-        CGContextRestoreGState(context);
-        
-        CGFloat xOffset = kTWMessageViewBarPadding;
-        CGFloat yOffset = kTWMessageViewBarPadding + [self statusBarOffset];
-        
-        // icon
-        CGContextSaveGState(context);
+    }
+    return nil;
+}
+
+- (void)startTicking
+{
+    if (self.clock)
+    {
+        if (self.clockTimer == nil)
         {
-            if ([styleSheet respondsToSelector:@selector(iconImageForMessageType:)])
-            {
-                [[styleSheet iconImageForMessageType:self.messageType] drawInRect:CGRectMake(xOffset, yOffset, kTWMessageViewIconSize, kTWMessageViewIconSize)];
-            }
+            [self scheduleClockTick];
         }
-        CGContextRestoreGState(context);
-        
-        yOffset -= kTWMessageViewTextOffset;
-        xOffset += kTWMessageViewIconSize + kTWMessageViewBarPadding;
-        
-        CGSize titleLabelSize = [self titleSize];
-        CGSize descriptionLabelSize = [self descriptionSize];
-        
-        if (self.titleString && !self.descriptionString)
+    }
+    else if (self.displayLink.paused)
+    {
+        self.lastTimestamp = 0.0;
+        self.displayLink.paused = NO;
+    }
+}
+
+- (void)stepAnimationsByInterval:(CFTimeInterval)interval
+{
+    for (TWMessageBarAnimation *animation in [self.animations copy])
+    {
+        if ([self.animations indexOfObjectIdenticalTo:animation] == NSNotFound)
         {
-            yOffset = ceil(rect.size.height * 0.5) - ceil(titleLabelSize.height * 0.5) - kTWMessageViewTextOffset;
+            continue; // stopped by an earlier completion block
         }
         
-        if ([[UIDevice currentDevice] tw_isRunningiOS7OrLater])
+        TWMessageBarSpring spring = animation.spring;
+        TWMessageBarSpringStep(&spring, interval);
+        BOOL settled = TWMessageBarSpringIsSettled(&spring, kTWMessageBarAnimatorPositionTolerance, kTWMessageBarAnimatorVelocityTolerance);
+        if (settled)
         {
-            NSMutableParagraphStyle *paragraphStyle = [[NSParagraphStyle defaultParagraphStyle] mutableCopy];
-            paragraphStyle.alignment = NSTextAlignmentLeft;
-            
-            [[self titleColor] set];
-            [self.titleString drawWithRect:CGRectMake(xOffset, yOffset, titleLabelSize.width, titleLabelSize.height)
-                                   options:NSStringDrawingUsesLineFragmentOrigin | NSStringDrawingTruncatesLastVisibleLine
-                                attributes:@{NSFontAttributeName:[self titleFont], NSForegroundColorAttributeName:[self titleColor], NSParagraphStyleAttributeName:paragraphStyle}
-                                   context:nil];
-            
-            yOffset += titleLabelSize.height;
-            
-            [[self descriptionColor] set];
-            [self.descriptionString drawWithRect:CGRectMake(xOffset, yOffset, descriptionLabelSize.width, descriptionLabelSize.height)
-                                         options:NSStringDrawingUsesLineFragmentOrigin | NSStringDrawingTruncatesLastVisibleLine
-                                      attributes:@{NSFontAttributeName:[self descriptionFont], NSForegroundColorAttributeName:[self descriptionColor], NSParagraphStyleAttributeName:paragraphStyle}
-                                         context:nil];
+            spring.position = spring.target;
+            spring.velocity = 0.0;
         }
-        else
+        animation.spring = spring;
+        
+        UIView *view = animation.view;
+        view.frame = CGRectMake(view.frame.origin.x, (CGFloat)spring.position, view.frame.size.width, view.frame.size.height);
+        
+        if (settled)
         {
-            [[self titleColor] set];
-#pragma clang diagnostic push
-#pragma clang diagnostic ignored "-Wdeprecated-declarations"
-            [self.titleString drawInRect:CGRectMake(xOffset, yOffset, titleLabelSize.width, titleLabelSize.height) withFont:[self titleFont] lineBreakMode:NSLineBreakByTruncatingTail alignment:NSTextAlignmentLeft];
-#pragma clang diagnostic pop
-            
-            yOffset += titleLabelSize.height;
-            
-            [[self descriptionColor] set];
-#pragma clang diagnostic push
-#pragma clang diagnostic ignored "-Wdeprecated-declarations"
-            [self.descriptionString drawInRect:CGRectMake(xOffset, yOffset, descriptionLabelSize.width, descriptionLabelSize.height) withFont:[self descriptionFont] lineBreakMode:NSLineBreakByTruncatingTail alignment:NSTextAlignmentLeft];
-#pragma clang diagnostic pop
+            [self.animations removeObjectIdenticalTo:animation];
+            if (animation.completion)
+            {
+                animation.completion(YES);
+            }
         }
     }
 }
 
-#pragma mark - Getters
+#pragma mark - Display Link
 
-- (CGFloat)height
+- (void)displayLinkDidFire:(CADisplayLink *)displayLink
 {
-    CGSize titleLabelSize = [self titleSize];
-    CGSize descriptionLabelSize = [self descriptionSize];
-    return MAX((kTWMessageViewBarPadding * 2) + titleLabelSize.height + descriptionLabelSize.height + [self statusBarOffset], (kTWMessageViewBarPadding * 2) + kTWMessageViewIconSize + [self statusBarOffset]);
+    CFTimeInterval interval = self.lastTimestamp > 0.0 ? displayLink.timestamp - self.lastTimestamp : displayLink.duration;
+    self.lastTimestamp = displayLink.timestamp;
+    interval = MIN(interval, kTWMessageBarAnimatorMaximumFrameInterval); // a hitch slows the bar down rather than teleporting it
+    
+    [self stepAnimationsByInterval:interval];
+    
+    if ([self.animations count] == 0)
+    {
+        self.displayLink.paused = YES;
+    }
 }
 
-- (CGFloat)width
-{
-    return [self statusBarFrame].size.width;
-}
+#pragma mark - Clock
 
-- (CGFloat)statusBarOffset
+- (void)scheduleClockTick
 {
-    return [[UIDevice currentDevice] tw_isRunningiOS7OrLater] ? [self statusBarFrame].size.height : 0.0;
+    // Fixed frames on the injected clock; the chain stops once nothing is in flight
+    __weak TWMessageBarAnimator *weakSelf = self;
+    self.clockTimer = [self.clock scheduleBlock:^{
+        TWMessageBarAnimator *strongSelf = weakSelf;
+        strongSelf.clockTimer = nil;
+        [strongSelf stepAnimationsByInterval:kTWMessageBarAnimatorClockFrameInterval];
+        if ([strongSelf.animations count] > 0 && strongSelf.clockTimer == nil)
+        {
+            [strongSelf scheduleClockTick];
+        }
+    } afterDelay:kTWMessageBarAnimatorClockFrameInterval];
 }
 
-- (CGFloat)availableWidth
-{
-    return ([self width] - (kTWMessageViewBarPadding * 3) - kTWMessageViewIconSize);
-}
+#pragma mark - Setters
 
-- (CGSize)titleSize
+- (void)setClock:(id<TWMessageBarClock>)clock
 {
-    CGSize boundedSize = CGSizeMake([self availableWidth], CGFLOAT_MAX);
-    CGSize titleLabelSize;
-    
-    if ([[UIDevice currentDevice] tw_isRunningiOS7OrLater])
-    {
-        NSDictionary *titleStringAttributes = [NSDictionary dictionaryWithObject:[self titleFont] forKey: NSFontAttributeName];
-        titleLabelSize = [self.titleString boundingRectWithSize:boundedSize
-                                                        options:NSStringDrawingTruncatesLastVisibleLine | NSStringDrawingUsesLineFragmentOrigin
-                                                     attributes:titleStringAttributes
-                                                        context:nil].size;
-    }
-    else
+    if (self.clockTimer)
     {
-#pragma clang diagnostic push
-#pragma clang diagnostic ignored "-Wdeprecated-declarations"
-        titleLabelSize = [_titleString sizeWithFont:[self titleFont] constrainedToSize:boundedSize lineBreakMode:NSLineBreakByTruncatingTail];
-#pragma clang diagnostic pop
+        [_clock cancelScheduledBlock:self.clockTimer];
+        self.clockTimer = nil;
     }
+    self.displayLink.paused = YES;
+    _clock = clock;
     
-    return CGSizeMake(ceilf(titleLabelSize.width), ceilf(titleLabelSize.height));
-}
-
-- (CGSize)descriptionSize
-{
-    CGSize boundedSize = CGSizeMake([self availableWidth], CGFLOAT_MAX);
-    CGSize descriptionLabelSize;
-    
-    if ([[UIDevice currentDevice] tw_isRunningiOS7OrLater])
-    {
-        NSDictionary *descriptionStringAttributes = [NSDictionary dictionaryWithObject:[self descriptionFont] forKey: NSFontAttributeName];
-        descriptionLabelSize = [self.descriptionString boundingRectWithSize:boundedSize
-                                                                    options:NSStringDrawingTruncatesLastVisibleLine | NSStringDrawingUsesLineFragmentOrigin
-                                                                 attributes:descriptionStringAttributes
-                                                                    context:nil].size;
-    }
-    else
+    if ([self.animations count] > 0)
     {
-#pragma clang diagnostic push
-#pragma clang diagnostic ignored "-Wdeprecated-declarations"
-        descriptionLabelSize = [_descriptionString sizeWithFont:[self descriptionFont] constrainedToSize:boundedSize lineBreakMode:NSLineBreakByTruncatingTail];
-#pragma clang diagnostic pop
+        [self startTicking];
     }
-    
-    return CGSizeMake(ceilf(descriptionLabelSize.width), ceilf(descriptionLabelSize.height));
 }
 
-- (CGRect)statusBarFrame
-{
-    CGRect windowFrame = NSFoundationVersionNumber <= NSFoundationVersionNumber_iOS_7_1 ? [self orientFrame:[UIApplication sharedApplication].keyWindow.frame] : [UIApplication sharedApplication].keyWindow.frame;
-    CGRect statusFrame = NSFoundationVersionNumber <= NSFoundationVersionNumber_iOS_7_1 ?  [self orientFrame:[UIApplication sharedApplication].statusBarFrame] : [UIApplication sharedApplication].statusBarFrame;
-    return CGRectMake(windowFrame.origin.x, windowFrame.origin.y, windowFrame.size.width, statusFrame.size.height);
-}
+@end
 
-- (UIFont *)titleFont
+@implementation TWMessageBarDisplayLinkTarget
+
+#pragma mark - Display Link
+
+- (void)displayLinkDidFire:(CADisplayLink *)displayLink
 {
-    if ([self.delegate respondsToSelector:@selector(styleSheetForMessageView:)])
-    {
-        id<TWMessageBarStyleSheet> styleSheet = [self.delegate styleSheetForMessageView:self];
-        if ([styleSheet respondsToSelector:@selector(titleFontForMessageType:)])
-        {
-            return [styleSheet titleFontForMessageType:self.messageType];
-        }
-    }
-    return kTWMessageViewTitleFont;
+    [self.animator displayLinkDidFire:displayLink];
 }
 
-- (UIFont *)descriptionFont
+@end
+
+@implementation TWMessageBarScheduledBlock
+
+#pragma mark - Actions
+
+- (void)fire
 {
-    if ([self.delegate respondsToSelector:@selector(styleSheetForMessageView:)])
+    if (self.block)
     {
-        id<TWMessageBarStyleSheet> styleSheet = [self.delegate styleSheetForMessageView:self];
-        if ([styleSheet respondsToSelector:@selector(descriptionFontForMessageType:)])
-        {
-            return [styleSheet descriptionFontForMessageType:self.messageType];
-        }
+        self.block();
     }
-    return kTWMessageViewDescriptionFont;
 }
 
-- (UIColor *)titleColor
+@end
+
+@implementation TWMessageBarSystemClock
+
+#pragma mark - TWMessageBarClock
+
+- (NSTimeInterval)currentTime
 {
-    if ([self.delegate respondsToSelector:@selector(styleSheetForMessageView:)])
-    {
-        id<TWMessageBarStyleSheet> styleSheet = [self.delegate styleSheetForMessageView:self];
-        if ([styleSheet respondsToSelector:@selector(titleColorForMessageType:)])
-        {
-            return [styleSheet titleColorForMessageType:self.messageType];
-        }
-    }
-    return kTWMessageViewTitleColor;
+    return CACurrentMediaTime();
 }
 
-- (UIColor *)descriptionColor
+- (id)scheduleBlock:(void (^)(void))block afterDelay:(NSTimeInterval)delay
 {
-    if ([self.delegate respondsToSelector:@selector(styleSheetForMessageView:)])
-    {
-        id<TWMessageBarStyleSheet> styleSheet = [self.delegate styleSheetForMessageView:self];
-        if ([styleSheet respondsToSelector:@selector(descriptionColorForMessageType:)])
-        {
-            return [styleSheet descriptionColorForMessageType:self.messageType];
-        }
-    }
-    return kTWMessageViewDescriptionColor;
+    TWMessageBarScheduledBlock *scheduledBlock = [[TWMessageBarScheduledBlock alloc] init];
+    scheduledBlock.block = block;
+    [scheduledBlock performSelector:@selector(fire) withObject:nil afterDelay:delay];
+    return scheduledBlock;
 }
 
-#pragma mark - Helpers
-
-- (CGRect)orientFrame:(CGRect)frame
+- (void)cancelScheduledBlock:(id)token
 {
-    return frame;
+    [NSObject cancelPreviousPerformRequestsWithTarget:token selector:@selector(fire) object:nil];
 }
 
-#pragma mark - Notifications
+@end
 
-- (void)didChangeDeviceOrientation:(NSNotification *)notification
+@interface TWMessageBarVirtualClock ()
 {
-    self.frame = CGRectMake(self.frame.origin.x, self.frame.origin.y, [self statusBarFrame].size.width, self.frame.size.height);
-    [self setNeedsDisplay];
+    TWMessageBarTimerQueue _timers; // retained TWMessageBarScheduledBlocks
 }
 
+@property (nonatomic, assign) NSTimeInterval now;
+
 @end
 
-@implementation TWDefaultMessageBarStyleSheet
+@implementation TWMessageBarVirtualClock
 
 #pragma mark - Alloc/Init
 
-+ (void)initialize
+- (id)init
 {
-	if (self == [TWDefaultMessageBarStyleSheet class])
-	{
-        // Colors (background)
-        kTWDefaultMessageBarStyleSheetErrorBackgroundColor = [UIColor colorWithRed:1.0 green:0.611 blue:0.0 alpha:kTWMessageBarStyleSheetMessageBarAlpha]; // orange
-        kTWDefaultMessageBarStyleSheetSuccessBackgroundColor = [UIColor colorWithRed:0.0f green:0.831f blue:0.176f alpha:kTWMessageBarStyleSheetMessageBarAlpha]; // green
-        kTWDefaultMessageBarStyleSheetInfoBackgroundColor = [UIColor colorWithRed:0.0 green:0.482 blue:1.0 alpha:kTWMessageBarStyleSheetMessageBarAlpha]; // blue
-        
-        // Colors (stroke)
-        kTWDefaultMessageBarStyleSheetErrorStrokeColor = [UIColor colorWithRed:0.949f green:0.580f blue:0.0f alpha:1.0f]; // orange
-        kTWDefaultMessageBarStyleSheetSuccessStrokeColor = [UIColor colorWithRed:0.0f green:0.772f blue:0.164f alpha:1.0f]; // green
-        kTWDefaultMessageBarStyleSheetInfoStrokeColor = [UIColor colorWithRed:0.0f green:0.415f blue:0.803f alpha:1.0f]; // blue
+    self = [super init];
+    if (self)
+    {
+        _now = 0.0;
     }
+    return self;
 }
 
-+ (TWDefaultMessageBarStyleSheet *)styleSheet
+#pragma mark - Memory Management
+
+- (void)dealloc
 {
-    return [[TWDefaultMessageBarStyleSheet alloc] init];
+    for (NSUInteger i = 0; i < _timers.count; i++)
+    {
+        CFBridgingRelease(_timers.timers[i].payload);
+    }
+    TWMessageBarTimerQueueRemoveAll(&_timers);
 }
 
-#pragma mark - TWMessageBarStyleSheet
+#pragma mark - TWMessageBarClock
 
-- (nonnull UIColor *)backgroundColorForMessageType:(TWMessageBarMessageType)type
+- (NSTimeInterval)currentTime
 {
-    UIColor *backgroundColor = nil;
-    switch (type)
-    {
-        case TWMessageBarMessageTypeError:
-            backgroundColor = kTWDefaultMessageBarStyleSheetErrorBackgroundColor;
-            break;
-        case TWMessageBarMessageTypeSuccess:
-            backgroundColor = kTWDefaultMessageBarStyleSheetSuccessBackgroundColor;
-            break;
-        case TWMessageBarMessageTypeInfo:
-            backgroundColor = kTWDefaultMessageBarStyleSheetInfoBackgroundColor;
-            break;
-    }
-    return backgroundColor;
+    return self.now;
 }
 
-- (nonnull UIColor *)strokeColorForMessageType:(TWMessageBarMessageType)type
+- (id)scheduleBlock:(void (^)(void))block afterDelay:(NSTimeInterval)delay
 {
-    UIColor *strokeColor = nil;
-    switch (type)
+    // Blocks due at the same time fire in the order they were scheduled
+    TWMessageBarScheduledBlock *scheduledBlock = [[TWMessageBarScheduledBlock alloc] init];
+    scheduledBlock.block = block;
+    void *payload = (__bridge_retained void *)scheduledBlock;
+    if (!TWMessageBarTimerQueueSchedule(&_timers, self.now + MAX(delay, 0.0), payload))
     {
-        case TWMessageBarMessageTypeError:
-            strokeColor = kTWDefaultMessageBarStyleSheetErrorStrokeColor;
-            break;
-        case TWMessageBarMessageTypeSuccess:
-            strokeColor = kTWDefaultMessageBarStyleSheetSuccessStrokeColor;
-            break;
-        case TWMessageBarMessageTypeInfo:
-            strokeColor = kTWDefaultMessageBarStyleSheetInfoStrokeColor;
-            break;
+        // The timer heap couldn't grow; callers rely on a token, so this is as fatal as any failed allocation
+        CFBridgingRelease(payload);
+        [NSException raise:NSMallocException format:@"Couldn't schedule a block on the virtual clock"];
     }
-    return strokeColor;
+    return scheduledBlock;
 }
 
-- (nonnull UIImage *)iconImageForMessageType:(TWMessageBarMessageType)type
+- (void)cancelScheduledBlock:(id)token
 {
-    UIImage *iconImage = nil;
-    switch (type)
+    // Tokens from another clock are never found, so they are left alone
+    if (token != nil && TWMessageBarTimerQueueCancel(&_timers, (__bridge void *)token))
     {
-        case TWMessageBarMessageTypeError:
-            iconImage = [UIImage imageNamed:kTWMessageBarStyleSheetImageIconError];
-            break;
-        case TWMessageBarMessageTypeSuccess:
-            iconImage = [UIImage imageNamed:kTWMessageBarStyleSheetImageIconSuccess];
-            break;
-        case TWMessageBarMessageTypeInfo:
-            iconImage = [UIImage imageNamed:kTWMessageBarStyleSheetImageIconInfo];
-            break;
+        CFBridgingRelease((__bridge void *)token);
     }
-    return iconImage;
 }
 
-@end
-
-@implementation TWMessageWindow
-
-#pragma mark - Touches
+#pragma mark - Simulation
 
-- (UIView *)hitTest:(CGPoint)point withEvent:(UIEvent *)event
+- (void)advanceBy:(NSTimeInterval)interval
 {
-    UIView *hitView = [super hitTest:point withEvent:event];
+    NSTimeInterval targetTime = self.now + MAX(interval, 0.0);
     
-    /*
-     * Pass touches through if they land on the rootViewController's view.
-     * Allows notification interaction without blocking the window below.
-     */
-    if ([hitView isEqual: self.rootViewController.view])
+    // Blocks scheduled while advancing run in this pass if they fall due before the target time
+    TWMessageBarTimer timer;
+    while (TWMessageBarTimerQueuePopDue(&_timers, targetTime, &timer))
     {
-        hitView = nil;
+        TWMessageBarScheduledBlock *scheduledBlock = (__bridge_transfer TWMessageBarScheduledBlock *)timer.payload;
+        self.now = timer.fireTime;
+        [scheduledBlock fire];
     }
-    
-    return hitView;
+    self.now = targetTime;
 }
 
 @end
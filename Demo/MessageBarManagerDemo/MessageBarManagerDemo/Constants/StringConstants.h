@@ -23,3 +23,5 @@
 #define kStringButtonLabelErrorMessage localize(@"button.label.error.message", @"Error Message")
 #define kStringButtonLabelInfoMessage localize(@"button.label.info.message", @"Information Message")
 #define kStringButtonLabelHideAll localize(@"button.label.hide.all", @"Hide All")
+#define kStringButtonLabelBenchmark localize(@"button.label.benchmark", @"Run Benchmark")
+#define kStringButtonLabelStressTest localize(@"button.label.stress.test", @"Run Stress Test")
@@ -14,9 +14,20 @@
 // Messages
 #import "TWMessageBarManager.h"
 
+// Quartz
+#import <QuartzCore/QuartzCore.h>
+
+// Memory
+#import <mach/mach.h>
+
 // Numerics
 CGFloat const kTWMesssageBarDemoControllerButtonPadding = 10.0f;
 CGFloat const kTWMesssageBarDemoControllerButtonHeight = 50.0f;
+NSUInteger const kTWMesssageBarDemoControllerBenchmarkIterations = 5;
+NSUInteger const kTWMesssageBarDemoControllerStressMessageCount = 100000;
+NSUInteger const kTWMesssageBarDemoControllerStressBytesPerMessageBudget = 1024;
+NSTimeInterval const kTWMesssageBarDemoControllerStressDrainDuration = 60.0;
+NSTimeInterval const kTWMesssageBarDemoControllerBackingStoreSampleDelay = 1.0;
 
 // Colors
 static UIColor *kTWMesssageBarDemoControllerButtonColor = nil;
@@ -27,12 +38,21 @@ static UIColor *kTWMesssageBarDemoControllerButtonColor = nil;
 @property (nonatomic, strong) UIButton *successButton;
 @property (nonatomic, strong) UIButton *infoButton;
 @property (nonatomic, strong) UIButton *hideAllButton;
+@property (nonatomic, strong) UIButton *benchmarkButton;
+@property (nonatomic, strong) UIButton *stressTestButton;
 
 // Button presses
 - (void)errorButtonPressed:(id)sender;
 - (void)successButtonPressed:(id)sender;
 - (void)infoButtonPressed:(id)sender;
 - (void)hideAllButtonPressed:(id)sender;
+- (void)benchmarkButtonPressed:(id)sender;
+- (void)stressTestButtonPressed:(id)sender;
+
+// Benchmarks
+- (void)benchmarkEnqueueWithQueueDepth:(NSUInteger)queueDepth descriptionLength:(NSUInteger)descriptionLength;
+- (void)benchmarkBackingStores;
+- (uint64_t)memoryFootprint;
 
 // Generators
 - (UIButton *)buttonWithTitle:(NSString *)title;
@@ -75,7 +95,7 @@ static UIColor *kTWMesssageBarDemoControllerButtonColor = nil;
     self.view.backgroundColor = [UIColor whiteColor];
     
     CGFloat xOffset = kTWMesssageBarDemoControllerButtonPadding;
-    CGFloat totalheight = (kTWMesssageBarDemoControllerButtonHeight * 4) + (kTWMesssageBarDemoControllerButtonPadding * 3);
+    CGFloat totalheight = (kTWMesssageBarDemoControllerButtonHeight * 6) + (kTWMesssageBarDemoControllerButtonPadding * 5);
     CGFloat yOffset = ceil(self.view.bounds.size.height * 0.5) - ceil(totalheight * 0.5);
     
     self.errorButton = [self buttonWithTitle:kStringButtonLabelErrorMessage];
@@ -103,6 +123,20 @@ static UIColor *kTWMesssageBarDemoControllerButtonColor = nil;
     self.hideAllButton.frame = CGRectMake(xOffset, yOffset, self.view.bounds.size.width - (xOffset * 2), kTWMesssageBarDemoControllerButtonHeight);
     [self.hideAllButton addTarget:self action:@selector(hideAllButtonPressed:) forControlEvents:UIControlEventTouchUpInside];
     [self.view addSubview:self.hideAllButton];
+    
+    yOffset += kTWMesssageBarDemoControllerButtonHeight + kTWMesssageBarDemoControllerButtonPadding;
+    
+    self.benchmarkButton = [self buttonWithTitle:kStringButtonLabelBenchmark];
+    self.benchmarkButton.frame = CGRectMake(xOffset, yOffset, self.view.bounds.size.width - (xOffset * 2), kTWMesssageBarDemoControllerButtonHeight);
+    [self.benchmarkButton addTarget:self action:@selector(benchmarkButtonPressed:) forControlEvents:UIControlEventTouchUpInside];
+    [self.view addSubview:self.benchmarkButton];
+    
+    yOffset += kTWMesssageBarDemoControllerButtonHeight + kTWMesssageBarDemoControllerButtonPadding;
+    
+    self.stressTestButton = [self buttonWithTitle:kStringButtonLabelStressTest];
+    self.stressTestButton.frame = CGRectMake(xOffset, yOffset, self.view.bounds.size.width - (xOffset * 2), kTWMesssageBarDemoControllerButtonHeight);
+    [self.stressTestButton addTarget:self action:@selector(stressTestButtonPressed:) forControlEvents:UIControlEventTouchUpInside];
+    [self.view addSubview:self.stressTestButton];
 }
 
 #pragma mark - Orientation
@@ -161,6 +195,131 @@ static UIColor *kTWMesssageBarDemoControllerButtonColor = nil;
     [[TWMessageBarManager sharedInstance] hideAllAnimated:YES];
 }
 
+- (void)benchmarkButtonPressed:(id)sender
+{
+    TWMessageBarManager *manager = [TWMessageBarManager sharedInstance];
+    [manager hideAllAnimated:NO];
+    [manager resetMetrics];
+    
+    for (NSNumber *queueDepth in @[@1, @100, @1000, @10000])
+    {
+        for (NSNumber *descriptionLength in @[@16, @256, @4096, @65536])
+        {
+            [self benchmarkEnqueueWithQueueDepth:[queueDepth unsignedIntegerValue] descriptionLength:[descriptionLength unsignedIntegerValue]];
+        }
+    }
+    
+    TWMessageBarMetrics metrics = manager.metrics;
+    NSLog(@"{\"benchmark\":\"queue_depth\",\"count\":%llu,\"p50\":%llu,\"p99\":%llu,\"max\":%llu}", metrics.queueDepth.count, metrics.queueDepth.p50, metrics.queueDepth.p99, metrics.queueDepth.maximum);
+    NSLog(@"{\"benchmark\":\"styleAttributesAllocations\",\"count\":%lu}", (unsigned long)manager.styleAttributesAllocationCount);
+    
+    [self benchmarkBackingStores];
+}
+
+- (void)stressTestButtonPressed:(id)sender
+{
+    TWMessageBarManager *manager = [TWMessageBarManager sharedInstance];
+    [manager hideAllAnimated:NO];
+    [manager resetMetrics];
+    
+    // Simulated time, so the drain below doesn't take real minutes
+    TWMessageBarVirtualClock *clock = [[TWMessageBarVirtualClock alloc] init];
+    manager.clock = clock;
+    
+    NSUInteger count = kTWMesssageBarDemoControllerStressMessageCount;
+    double *latencies = malloc(sizeof(double) * count);
+    memset(latencies, 0, sizeof(double) * count); // resident before the baseline, so it isn't charged to the messages
+    
+    // The first presentation builds the window and a view; it happens here, so every timed message is only queued
+    [manager showMessageWithTitle:kStringMessageBarInfoTitle description:kStringMessageBarInfoMessage type:TWMessageBarMessageTypeInfo];
+    uint64_t baseFootprint = [self memoryFootprint];
+    
+    // A buggy producer: every message is distinct, so nothing can be shared between descriptors
+    for (NSUInteger index = 0; index < count; index++)
+    {
+        NSString *description = [NSString stringWithFormat:@"Burst message %lu", (unsigned long)index];
+        CFTimeInterval start = CACurrentMediaTime();
+        [manager showMessageWithTitle:kStringMessageBarErrorTitle description:description type:TWMessageBarMessageTypeError];
+        latencies[index] = (CACurrentMediaTime() - start) * NSEC_PER_SEC;
+    }
+    
+    uint64_t peakFootprint = [self memoryFootprint];
+    double bytesPerMessage = peakFootprint > baseFootprint ? (double)(peakFootprint - baseFootprint) / count : 0.0;
+    
+    qsort_b(latencies, count, sizeof(double), ^int(const void *a, const void *b) {
+        double difference = *(const double *)a - *(const double *)b;
+        return difference < 0.0 ? -1 : (difference > 0.0 ? 1 : 0);
+    });
+    NSLog(@"{\"stress\":\"enqueue\",\"messages\":%lu,\"p50Ns\":%.0f,\"p99Ns\":%.0f,\"maxNs\":%.0f}", (unsigned long)count, latencies[count / 2], latencies[(count * 99) / 100], latencies[count - 1]);
+    free(latencies);
+    
+    // Reported only; the portable queue budget is asserted by Tests/TWMessageBarSimulationTests.c
+    BOOL withinBudget = bytesPerMessage <= kTWMesssageBarDemoControllerStressBytesPerMessageBudget;
+    NSLog(@"{\"stress\":\"memory\",\"peakFootprint\":%llu,\"bytesPerMessage\":%.0f,\"budget\":%lu,\"passed\":%@}", peakFootprint, bytesPerMessage, (unsigned long)kTWMesssageBarDemoControllerStressBytesPerMessageBudget, withinBudget ? @"true" : @"false");
+    
+    // Drain for a simulated minute, then drop the rest of the backlog
+    for (NSTimeInterval elapsed = 0.0; elapsed < kTWMesssageBarDemoControllerStressDrainDuration; elapsed += 1.0)
+    {
+        [clock advanceBy:1.0];
+    }
+    [manager hideAllAnimated:NO];
+    
+    TWMessageBarMetrics metrics = manager.metrics;
+    NSLog(@"{\"stress\":\"drain\",\"simulatedSeconds\":%.0f,\"presented\":%lu,\"timedOut\":%lu,\"discarded\":%lu,\"timeToVisibleP50Us\":%llu}", kTWMesssageBarDemoControllerStressDrainDuration, (unsigned long)metrics.presentedCount, (unsigned long)metrics.timedOutCount, (unsigned long)metrics.discardedCount, metrics.timeToVisible.p50);
+    
+    manager.clock = nil;
+}
+
+#pragma mark - Benchmarks
+
+- (void)benchmarkEnqueueWithQueueDepth:(NSUInteger)queueDepth descriptionLength:(NSUInteger)descriptionLength
+{
+    TWMessageBarManager *manager = [TWMessageBarManager sharedInstance];
+    NSString *description = [@"" stringByPaddingToLength:descriptionLength withString:@"Lorem ipsum dolor sit amet. " startingAtIndex:0];
+    CFTimeInterval best = DBL_MAX;
+    
+    // Best of several runs; each run fills the queue to the given depth and drops it again without animating
+    for (NSUInteger iteration = 0; iteration < kTWMesssageBarDemoControllerBenchmarkIterations; iteration++)
+    {
+        // A bar takes the only slot before the clock starts, so every timed message is queued rather than presented
+        [manager showMessageWithTitle:kStringMessageBarInfoTitle description:description type:TWMessageBarMessageTypeInfo];
+        
+        CFTimeInterval start = CACurrentMediaTime();
+        for (NSUInteger index = 0; index < queueDepth; index++)
+        {
+            [manager showMessageWithTitle:kStringMessageBarInfoTitle description:description type:(TWMessageBarMessageType)(index % 3)];
+        }
+        best = MIN(best, CACurrentMediaTime() - start);
+        [manager hideAllAnimated:NO];
+    }
+    
+    NSLog(@"{\"benchmark\":\"enqueue\",\"queueDepth\":%lu,\"descriptionLength\":%lu,\"nsPerMessage\":%.0f}", (unsigned long)queueDepth, (unsigned long)descriptionLength, (best * NSEC_PER_SEC) / queueDepth);
+}
+
+- (void)benchmarkBackingStores
+{
+    TWMessageBarManager *manager = [TWMessageBarManager sharedInstance];
+    NSString *description = [@"" stringByPaddingToLength:256 withString:@"Lorem ipsum dolor sit amet. " startingAtIndex:0];
+    [manager showMessageWithTitle:kStringMessageBarInfoTitle description:description type:TWMessageBarMessageTypeInfo];
+    
+    // Backing stores only exist once the bar has drawn and come to rest
+    dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(kTWMesssageBarDemoControllerBackingStoreSampleDelay * NSEC_PER_SEC)), dispatch_get_main_queue(), ^{
+        NSLog(@"{\"benchmark\":\"backingStore\",\"screenScale\":%.0f,\"bytes\":%lu}", [UIScreen mainScreen].scale, (unsigned long)manager.metrics.backingStoreBytes);
+        [manager hideAllAnimated:NO];
+    });
+}
+
+- (uint64_t)memoryFootprint
+{
+    task_vm_info_data_t info;
+    mach_msg_type_number_t infoCount = TASK_VM_INFO_COUNT;
+    if (task_info(mach_task_self(), TASK_VM_INFO, (task_info_t)&info, &infoCount) != KERN_SUCCESS)
+    {
+        return 0;
+    }
+    return info.phys_footprint;
+}
+
 #pragma mark - Generators
 
 - (UIButton *)buttonWithTitle:(NSString *)title
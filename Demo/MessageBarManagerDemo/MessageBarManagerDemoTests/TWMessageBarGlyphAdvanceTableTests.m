@@ -0,0 +1,170 @@
+//
+//  TWMessageBarGlyphAdvanceTableTests.m
+//  MessageBarManagerDemo
+//
+//  Created by Terry Worona on 5/13/13.
+//  Copyright (c) 2013 Terry Worona. All rights reserved.
+//
+//  Checks the manager's glyph advance table (the single-line measuring fast path) against the full text system.
+//  The table is private to TWMessageBarManager.m, which the host app compiles; it's looked up by name.
+//
+
+#import <XCTest/XCTest.h>
+#import <UIKit/UIKit.h>
+
+// Numerics
+CGFloat const kTWMessageBarGlyphAdvanceTableTestsWidthTolerance = 1.0f; // measured widths are rounded up to whole points
+CGFloat const kTWMessageBarGlyphAdvanceTableTestsKerningTolerance = 0.01f; // kTWMessageBarGlyphAdvanceTableKerningTolerance
+unichar const kTWMessageBarGlyphAdvanceTableTestsFirstCharacter = 0x20; // TW_ADVANCE_TABLE_FIRST_CHARACTER
+NSUInteger const kTWMessageBarGlyphAdvanceTableTestsCharacterCount = 95; // TW_ADVANCE_TABLE_COUNT
+
+// Strings
+NSString * const kTWMessageBarGlyphAdvanceTableTestsClassName = @"TWMessageBarGlyphAdvanceTable";
+
+@protocol TWMessageBarGlyphAdvanceTableTesting <NSObject>
+
++ (id<TWMessageBarGlyphAdvanceTableTesting>)tableForFont:(UIFont *)font;
+- (CGFloat)lineHeight;
+- (BOOL)measureCharacters:(const unichar *)characters length:(NSUInteger)length width:(CGFloat *)width;
+
+@end
+
+@interface TWMessageBarGlyphAdvanceTableTests : XCTestCase
+
+// Helpers
+- (NSArray *)fonts;
+- (id<TWMessageBarGlyphAdvanceTableTesting>)tableForFont:(UIFont *)font;
+- (BOOL)measureString:(NSString *)string table:(id<TWMessageBarGlyphAdvanceTableTesting>)table width:(CGFloat *)width;
+
+@end
+
+@implementation TWMessageBarGlyphAdvanceTableTests
+
+#pragma mark - Tests
+
+- (void)testTableIsAvailable
+{
+    XCTAssertNotNil(NSClassFromString(kTWMessageBarGlyphAdvanceTableTestsClassName), @"%@ was renamed; update these tests", kTWMessageBarGlyphAdvanceTableTestsClassName);
+}
+
+- (void)testSentencesMatchTextSystem
+{
+    NSArray *strings = @[@"Success", @"Your settings were saved.", @"Error", @"The request timed out; try again in a minute.", @"Info", @"0123456789 !\"#$%&'()*+,-./:;<=>?@[\\]^_`{|}~", @"The quick brown fox jumps over the lazy dog", @"THE QUICK BROWN FOX JUMPS OVER THE LAZY DOG"];
+    for (UIFont *font in [self fonts])
+    {
+        NSDictionary *attributes = @{NSFontAttributeName:font};
+        id<TWMessageBarGlyphAdvanceTableTesting> table = [self tableForFont:font];
+        NSUInteger measuredCount = 0;
+        for (NSString *string in strings)
+        {
+            CGFloat width = 0.0;
+            if (![self measureString:string table:table width:&width])
+            {
+                continue; // kerned somewhere; the full text system measures it
+            }
+            measuredCount++;
+            
+            CGSize fullSize = [string boundingRectWithSize:CGSizeMake(CGFLOAT_MAX, CGFLOAT_MAX) options:NSStringDrawingUsesLineFragmentOrigin attributes:attributes context:nil].size;
+            XCTAssertEqualWithAccuracy(ceilf(width), ceilf(fullSize.width), kTWMessageBarGlyphAdvanceTableTestsWidthTolerance, @"\"%@\" in %@", string, font);
+            XCTAssertEqualWithAccuracy(ceilf(table.lineHeight), ceilf(fullSize.height), kTWMessageBarGlyphAdvanceTableTestsWidthTolerance, @"\"%@\" in %@", string, font);
+        }
+        XCTAssertTrue(measuredCount > 0, @"%@ never took the fast path", font);
+    }
+}
+
+- (void)testEveryPairMatchesTextSystem
+{
+    for (UIFont *font in [self fonts])
+    {
+        NSDictionary *attributes = @{NSFontAttributeName:font};
+        id<TWMessageBarGlyphAdvanceTableTesting> table = [self tableForFont:font];
+        NSUInteger kernedCount = 0;
+        for (NSUInteger first = 0; first < kTWMessageBarGlyphAdvanceTableTestsCharacterCount; first++)
+        {
+            for (NSUInteger second = 0; second < kTWMessageBarGlyphAdvanceTableTestsCharacterCount; second++)
+            {
+                unichar pair[2] = {(unichar)(kTWMessageBarGlyphAdvanceTableTestsFirstCharacter + first), (unichar)(kTWMessageBarGlyphAdvanceTableTestsFirstCharacter + second)};
+                NSString *string = [NSString stringWithCharacters:pair length:2];
+                CGFloat pairWidth = [string sizeWithAttributes:attributes].width;
+                CGFloat unkernedWidth = [[NSString stringWithCharacters:&pair[0] length:1] sizeWithAttributes:attributes].width + [[NSString stringWithCharacters:&pair[1] length:1] sizeWithAttributes:attributes].width;
+                
+                CGFloat width = 0.0;
+                BOOL measured = [table measureCharacters:pair length:2 width:&width];
+                if (fabs(pairWidth - unkernedWidth) > kTWMessageBarGlyphAdvanceTableTestsKerningTolerance)
+                {
+                    // Kerned (AV, To, ...): summing advances would be wrong, so the table has to refuse it
+                    kernedCount++;
+                    XCTAssertFalse(measured, @"Kerned pair \"%@\" in %@ measured %f, text system %f", string, font, width, pairWidth);
+                }
+                else
+                {
+                    XCTAssertTrue(measured, @"\"%@\" in %@", string, font);
+                    XCTAssertEqualWithAccuracy(width, pairWidth, kTWMessageBarGlyphAdvanceTableTestsKerningTolerance, @"\"%@\" in %@", string, font);
+                }
+            }
+        }
+        NSLog(@"%@: %lu kerned pairs", font.fontName, (unsigned long)kernedCount);
+    }
+}
+
+- (void)testKernedPairsFallBack
+{
+    // Pairs that are kerned in most text faces, alone and inside a word
+    NSArray *strings = @[@"AV", @"AW", @"To", @"Ta", @"Wa", @"Yo", @"LT", @"P.", @"AVATAR", @"Tomorrow"];
+    for (UIFont *font in [self fonts])
+    {
+        NSDictionary *attributes = @{NSFontAttributeName:font};
+        id<TWMessageBarGlyphAdvanceTableTesting> table = [self tableForFont:font];
+        for (NSString *string in strings)
+        {
+            CGFloat width = 0.0;
+            if ([self measureString:string table:table width:&width])
+            {
+                // Only allowed where this font doesn't actually kern the string
+                XCTAssertEqualWithAccuracy(width, [string sizeWithAttributes:attributes].width, kTWMessageBarGlyphAdvanceTableTestsKerningTolerance * [string length], @"\"%@\" in %@", string, font);
+            }
+        }
+    }
+}
+
+- (void)testControlCharactersFallBack
+{
+    id<TWMessageBarGlyphAdvanceTableTesting> table = [self tableForFont:[UIFont systemFontOfSize:14.0]];
+    CGFloat width = 0.0;
+    XCTAssertFalse([self measureString:@"tab\there" table:table width:&width]);
+    XCTAssertFalse([self measureString:@"line\nbreak" table:table width:&width]);
+    XCTAssertFalse([self measureString:@"café" table:table width:&width]);
+}
+
+#pragma mark - Helpers
+
+- (NSArray *)fonts
+{
+    // The default style sheet's fonts, plus faces with heavier kerning tables
+    NSMutableArray *fonts = [NSMutableArray arrayWithObjects:[UIFont boldSystemFontOfSize:16.0], [UIFont systemFontOfSize:14.0], [UIFont systemFontOfSize:11.0], [UIFont systemFontOfSize:24.0], nil];
+    for (NSString *fontName in @[@"Georgia", @"TimesNewRomanPSMT", @"HelveticaNeue", @"Avenir-Book", @"Courier"])
+    {
+        UIFont *font = [UIFont fontWithName:fontName size:15.0];
+        if (font)
+        {
+            [fonts addObject:font];
+        }
+    }
+    return fonts;
+}
+
+- (id<TWMessageBarGlyphAdvanceTableTesting>)tableForFont:(UIFont *)font
+{
+    Class<TWMessageBarGlyphAdvanceTableTesting> tableClass = (Class<TWMessageBarGlyphAdvanceTableTesting>)NSClassFromString(kTWMessageBarGlyphAdvanceTableTestsClassName);
+    return [tableClass tableForFont:font];
+}
+
+- (BOOL)measureString:(NSString *)string table:(id<TWMessageBarGlyphAdvanceTableTesting>)table width:(CGFloat *)width
+{
+    NSUInteger length = [string length];
+    unichar characters[length];
+    [string getCharacters:characters range:NSMakeRange(0, length)];
+    return [table measureCharacters:characters length:length width:width];
+}
+
+@end
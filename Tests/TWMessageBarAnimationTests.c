@@ -0,0 +1,139 @@
+//
+//  TWMessageBarAnimationTests.c
+//
+//  Created by Terry Worona on 5/13/13.
+//  Copyright (c) 2013 Terry Worona. All rights reserved.
+//
+//  The bar animator's spring and the pan release projection.
+//
+
+#include "TWMessageBarCore.h"
+#include "TWMessageBarTest.h"
+
+#include <math.h>
+
+// Numerics
+#define TW_ANIMATION_TEST_SETTLE_DURATION 0.25 // kTWMessageBarManagerDismissAnimationDuration
+#define TW_ANIMATION_TEST_POSITION_TOLERANCE 0.5 // kTWMessageBarAnimatorPositionTolerance
+#define TW_ANIMATION_TEST_VELOCITY_TOLERANCE 10.0 // kTWMessageBarAnimatorVelocityTolerance
+#define TW_ANIMATION_TEST_DECAY_TIME_CONSTANT 0.2 // kTWMessageBarManagerPanDecayTimeConstant
+
+static double TWMessageBarTestSpringPositionAfter(double duration, double frameInterval, double *maximumPosition)
+{
+    // From -100 (a bar above the screen) to rest at 0
+    TWMessageBarSpring spring = TWMessageBarSpringMake(-100.0, 0.0, 0.0, TW_ANIMATION_TEST_SETTLE_DURATION);
+    for (double elapsed = 0.0; elapsed < duration - (frameInterval * 0.5); elapsed += frameInterval)
+    {
+        TWMessageBarSpringStep(&spring, frameInterval);
+        if (maximumPosition && spring.position > *maximumPosition)
+        {
+            *maximumPosition = spring.position;
+        }
+    }
+    return spring.position;
+}
+
+// Spring
+
+static void TWMessageBarTestSpringSettlesWithinDuration(void)
+{
+    // Critically damped: (1 + 8) e^-8 of the distance, about 0.3%, is left after the settle duration (Euler lags a little)
+    double position = TWMessageBarTestSpringPositionAfter(TW_ANIMATION_TEST_SETTLE_DURATION, 1.0 / 60.0, NULL);
+    TW_ASSERT(fabs(position) < 1.0);
+    
+    // Still well short of the target a quarter of the way in
+    TW_ASSERT(TWMessageBarTestSpringPositionAfter(TW_ANIMATION_TEST_SETTLE_DURATION * 0.25, 1.0 / 60.0, NULL) < -20.0);
+}
+
+static void TWMessageBarTestSpringFollowsClosedForm(void)
+{
+    double omega = TW_SPRING_SETTLE_CONSTANT / TW_ANIMATION_TEST_SETTLE_DURATION;
+    for (double t = 0.05; t <= TW_ANIMATION_TEST_SETTLE_DURATION; t += 0.05)
+    {
+        double expected = -100.0 * (1.0 + (omega * t)) * exp(-omega * t);
+        double position = TWMessageBarTestSpringPositionAfter(t, TW_SPRING_STEP_INTERVAL, NULL);
+        TW_ASSERT(fabs(position - expected) < 5.0); // within 5% of the distance
+    }
+}
+
+static void TWMessageBarTestSpringIgnoresFrameRate(void)
+{
+    // Fixed sub-steps: 30, 60 and 120 Hz displays move the bar identically
+    double position30 = TWMessageBarTestSpringPositionAfter(0.1, 1.0 / 30.0, NULL);
+    double position60 = TWMessageBarTestSpringPositionAfter(0.1, 1.0 / 60.0, NULL);
+    double position120 = TWMessageBarTestSpringPositionAfter(0.1, 1.0 / 120.0, NULL);
+    TW_ASSERT(fabs(position30 - position60) < 1e-6);
+    TW_ASSERT(fabs(position60 - position120) < 1e-6);
+}
+
+static void TWMessageBarTestSpringDoesNotOvershoot(void)
+{
+    double maximumPosition = -100.0;
+    TWMessageBarTestSpringPositionAfter(TW_ANIMATION_TEST_SETTLE_DURATION * 4.0, 1.0 / 60.0, &maximumPosition);
+    TW_ASSERT(maximumPosition < TW_ANIMATION_TEST_POSITION_TOLERANCE);
+}
+
+static void TWMessageBarTestSpringStaysStableThroughHitch(void)
+{
+    // A one second hitch is stepped in sub-steps rather than one explosive Euler step
+    TWMessageBarSpring spring = TWMessageBarSpringMake(-100.0, -3000.0, 0.0, TW_ANIMATION_TEST_SETTLE_DURATION);
+    TWMessageBarSpringStep(&spring, 1.0);
+    TW_ASSERT(TWMessageBarSpringIsSettled(&spring, TW_ANIMATION_TEST_POSITION_TOLERANCE, TW_ANIMATION_TEST_VELOCITY_TOLERANCE));
+}
+
+static void TWMessageBarTestSpringSettledNeedsBothTolerances(void)
+{
+    TWMessageBarSpring spring = TWMessageBarSpringMake(0.2, 0.0, 0.0, TW_ANIMATION_TEST_SETTLE_DURATION);
+    TW_ASSERT(TWMessageBarSpringIsSettled(&spring, TW_ANIMATION_TEST_POSITION_TOLERANCE, TW_ANIMATION_TEST_VELOCITY_TOLERANCE));
+    
+    spring.velocity = 50.0; // passing through the target
+    TW_ASSERT(!TWMessageBarSpringIsSettled(&spring, TW_ANIMATION_TEST_POSITION_TOLERANCE, TW_ANIMATION_TEST_VELOCITY_TOLERANCE));
+    
+    spring.velocity = 0.0;
+    spring.position = 1.0;
+    TW_ASSERT(!TWMessageBarSpringIsSettled(&spring, TW_ANIMATION_TEST_POSITION_TOLERANCE, TW_ANIMATION_TEST_VELOCITY_TOLERANCE));
+}
+
+static void TWMessageBarTestSpringKeepsReleaseVelocity(void)
+{
+    // A flung bar keeps moving the way it was thrown before the spring pulls it in
+    TWMessageBarSpring spring = TWMessageBarSpringMake(0.0, -2000.0, -64.0, TW_ANIMATION_TEST_SETTLE_DURATION);
+    TWMessageBarSpringStep(&spring, 1.0 / 60.0);
+    TW_ASSERT(spring.position < -20.0);
+    TW_ASSERT(spring.velocity < 0.0);
+}
+
+// Decay
+
+static void TWMessageBarTestDecayProjection(void)
+{
+    TW_ASSERT(TWMessageBarDecayProjectedPosition(12.0, 0.0, TW_ANIMATION_TEST_DECAY_TIME_CONSTANT) == 12.0);
+    
+    // Exponential decay covers velocity x time constant in total
+    TW_ASSERT(fabs(TWMessageBarDecayProjectedPosition(0.0, -500.0, TW_ANIMATION_TEST_DECAY_TIME_CONSTANT) + 100.0) < 1e-9);
+    TW_ASSERT(fabs(TWMessageBarDecayProjectedPosition(10.0, 250.0, TW_ANIMATION_TEST_DECAY_TIME_CONSTANT) - 60.0) < 1e-9);
+    
+    // Integrating v(t) = v0 e^(-t/tau) numerically lands on the projection
+    double position = 0.0;
+    double velocity = -800.0;
+    double step = 1e-4;
+    for (double t = 0.0; t < TW_ANIMATION_TEST_DECAY_TIME_CONSTANT * 20.0; t += step)
+    {
+        position += velocity * step;
+        velocity *= exp(-step / TW_ANIMATION_TEST_DECAY_TIME_CONSTANT);
+    }
+    TW_ASSERT(fabs(position - TWMessageBarDecayProjectedPosition(0.0, -800.0, TW_ANIMATION_TEST_DECAY_TIME_CONSTANT)) < 0.5);
+}
+
+int main(void)
+{
+    TW_RUN_TEST(TWMessageBarTestSpringSettlesWithinDuration);
+    TW_RUN_TEST(TWMessageBarTestSpringFollowsClosedForm);
+    TW_RUN_TEST(TWMessageBarTestSpringIgnoresFrameRate);
+    TW_RUN_TEST(TWMessageBarTestSpringDoesNotOvershoot);
+    TW_RUN_TEST(TWMessageBarTestSpringStaysStableThroughHitch);
+    TW_RUN_TEST(TWMessageBarTestSpringSettledNeedsBothTolerances);
+    TW_RUN_TEST(TWMessageBarTestSpringKeepsReleaseVelocity);
+    TW_RUN_TEST(TWMessageBarTestDecayProjection);
+    return TWMessageBarTestFailureCount > 0 ? 1 : 0;
+}
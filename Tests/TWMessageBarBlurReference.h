@@ -0,0 +1,79 @@
+//
+//  TWMessageBarBlurReference.h
+//
+//  Created by Terry Worona on 5/13/13.
+//  Copyright (c) 2013 Terry Worona. All rights reserved.
+//
+//  Straightforward scalar version of TWMessageBarBoxBlur: the same passes, edge handling and fixed-point rounding,
+//  one channel at a time with every window summed from scratch. The vectorised blur must match it exactly.
+//
+
+#ifndef TWMessageBarBlurReference_h
+#define TWMessageBarBlurReference_h
+
+#include "TWMessageBarCore.h"
+
+#include <stdlib.h>
+
+static inline uint8_t TWMessageBarBlurReferenceAverage(uint32_t sum, size_t radius)
+{
+    uint32_t reciprocal = (uint32_t)((65536 + radius) / (2 * radius + 1));
+    return (uint8_t)(((sum * reciprocal) + (1 << 15)) >> 16);
+}
+
+static inline size_t TWMessageBarBlurReferenceClamp(long index, size_t count)
+{
+    return index < 0 ? 0 : ((size_t)index >= count ? count - 1 : (size_t)index);
+}
+
+/*
+ * @return Zero if the buffer couldn't be allocated; the pixels are then untouched.
+ */
+static inline int TWMessageBarBoxBlurReference(uint8_t *pixels, size_t width, size_t height, size_t radius)
+{
+    radius = radius < TW_BLUR_MAXIMUM_RADIUS ? radius : TW_BLUR_MAXIMUM_RADIUS;
+    if (radius == 0 || width == 0 || height == 0 || width % TW_BLUR_BLOCK_PIXELS != 0 || height % TW_BLUR_BLOCK_PIXELS != 0)
+    {
+        return 1;
+    }
+    uint8_t *vertical = malloc(width * height * 4);
+    if (!vertical)
+    {
+        return 0;
+    }
+    
+    for (int pass = 0; pass < TW_BLUR_PASSES; pass++)
+    {
+        for (size_t y = 0; y < height; y++)
+        {
+            for (size_t x = 0; x < width * 4; x++)
+            {
+                uint32_t sum = 0;
+                for (long offset = -(long)radius; offset <= (long)radius; offset++)
+                {
+                    sum += pixels[(TWMessageBarBlurReferenceClamp((long)y + offset, height) * width * 4) + x];
+                }
+                vertical[(y * width * 4) + x] = TWMessageBarBlurReferenceAverage(sum, radius);
+            }
+        }
+        for (size_t y = 0; y < height; y++)
+        {
+            for (size_t x = 0; x < width; x++)
+            {
+                for (size_t channel = 0; channel < 4; channel++)
+                {
+                    uint32_t sum = 0;
+                    for (long offset = -(long)radius; offset <= (long)radius; offset++)
+                    {
+                        sum += vertical[(((y * width) + TWMessageBarBlurReferenceClamp((long)x + offset, width)) * 4) + channel];
+                    }
+                    pixels[(((y * width) + x) * 4) + channel] = TWMessageBarBlurReferenceAverage(sum, radius);
+                }
+            }
+        }
+    }
+    free(vertical);
+    return 1;
+}
+
+#endif
@@ -0,0 +1,154 @@
+//
+//  TWMessageBarBlurTests.c
+//
+//  Created by Terry Worona on 5/13/13.
+//  Copyright (c) 2013 Terry Worona. All rights reserved.
+//
+
+#include "TWMessageBarBlurReference.h"
+#include "TWMessageBarTest.h"
+
+#include <math.h>
+#include <string.h>
+
+static uint64_t kTWMessageBarBlurTestState = 0xD1B54A32D192ED03ULL;
+
+static uint64_t TWMessageBarBlurTestRandom(void)
+{
+    kTWMessageBarBlurTestState ^= kTWMessageBarBlurTestState << 13;
+    kTWMessageBarBlurTestState ^= kTWMessageBarBlurTestState >> 7;
+    kTWMessageBarBlurTestState ^= kTWMessageBarBlurTestState << 17;
+    return kTWMessageBarBlurTestState;
+}
+
+static void TWMessageBarBlurTestFillPremultiplied(uint8_t *pixels, size_t pixelCount)
+{
+    for (size_t i = 0; i < pixelCount; i++)
+    {
+        uint64_t random = TWMessageBarBlurTestRandom();
+        uint8_t alpha = (random & 3) == 0 ? 255 : (uint8_t)(random >> 8);
+        pixels[(i * 4) + 0] = (uint8_t)((((random >> 16) & 0xFF) * alpha) / 255);
+        pixels[(i * 4) + 1] = (uint8_t)((((random >> 24) & 0xFF) * alpha) / 255);
+        pixels[(i * 4) + 2] = (uint8_t)((((random >> 32) & 0xFF) * alpha) / 255);
+        pixels[(i * 4) + 3] = alpha;
+    }
+}
+
+/*
+ * Blurs a copy of `pixels` both ways; leaves the vectorised result in `pixels`.
+ */
+static int TWMessageBarBlurTestMatchesReference(uint8_t *pixels, size_t width, size_t height, size_t radius)
+{
+    size_t byteCount = width * height * 4;
+    uint8_t *reference = malloc(byteCount);
+    void *scratch = NULL;
+    if (!reference || posix_memalign(&scratch, 64, TWMessageBarBoxBlurScratchSize(width, height)) != 0)
+    {
+        free(reference);
+        TW_ASSERT(0);
+        return 0;
+    }
+    memcpy(reference, pixels, byteCount);
+    
+    TWMessageBarBoxBlur(pixels, width, height, radius, scratch);
+    TW_ASSERT(TWMessageBarBoxBlurReference(reference, width, height, radius));
+    int matches = memcmp(pixels, reference, byteCount) == 0;
+    
+    free(reference);
+    free(scratch);
+    return matches;
+}
+
+// Tests
+
+static void TWMessageBarTestFixedPointDivideStaysClose(void)
+{
+    // Every window sum at every radius lands within one level of the true average, exact for flat windows
+    for (size_t radius = 1; radius <= TW_BLUR_MAXIMUM_RADIUS; radius++)
+    {
+        size_t windowSize = (2 * radius) + 1;
+        size_t farCount = 0;
+        size_t flatMissCount = 0;
+        for (uint32_t sum = 0; sum <= 255 * windowSize; sum++)
+        {
+            uint8_t average = TWMessageBarBlurReferenceAverage(sum, radius);
+            farCount += fabs((double)average - ((double)sum / (double)windowSize)) >= 1.0;
+            flatMissCount += sum % windowSize == 0 && average != sum / windowSize;
+        }
+        TW_ASSERT_EQUAL(farCount, 0);
+        TW_ASSERT_EQUAL(flatMissCount, 0);
+    }
+}
+
+static void TWMessageBarTestBlurMatchesReference(void)
+{
+    static const size_t sizes[][2] = {{4, 4}, {8, 4}, {4, 16}, {96, 24}, {24, 96}, {36, 12}, {256, 60}};
+    static const size_t radii[] = {1, 2, 3, 5, 8, 17, 31, 32, 40};
+    for (size_t sizeIndex = 0; sizeIndex < sizeof(sizes) / sizeof(*sizes); sizeIndex++)
+    {
+        size_t width = sizes[sizeIndex][0];
+        size_t height = sizes[sizeIndex][1];
+        uint8_t *pixels = malloc(width * height * 4);
+        TW_ASSERT(pixels != NULL);
+        if (!pixels)
+        {
+            continue;
+        }
+        for (size_t radiusIndex = 0; radiusIndex < sizeof(radii) / sizeof(*radii); radiusIndex++)
+        {
+            TWMessageBarBlurTestFillPremultiplied(pixels, width * height);
+            int matches = TWMessageBarBlurTestMatchesReference(pixels, width, height, radii[radiusIndex]);
+            if (!matches)
+            {
+                fprintf(stderr, "%zux%zu radius %zu differs from the reference\n", width, height, radii[radiusIndex]);
+            }
+            TW_ASSERT(matches);
+            
+            // Still premultiplied: no channel ends up brighter than its alpha
+            size_t brighterCount = 0;
+            for (size_t i = 0; i < width * height; i++)
+            {
+                uint8_t alpha = pixels[(i * 4) + 3];
+                brighterCount += pixels[(i * 4) + 0] > alpha || pixels[(i * 4) + 1] > alpha || pixels[(i * 4) + 2] > alpha;
+            }
+            TW_ASSERT_EQUAL(brighterCount, 0);
+        }
+        free(pixels);
+    }
+}
+
+static void TWMessageBarTestBlurKeepsFlatColor(void)
+{
+    uint8_t pixels[32 * 8 * 4];
+    for (size_t i = 0; i < 32 * 8; i++)
+    {
+        memcpy(pixels + (i * 4), (const uint8_t[]){40, 80, 120, 200}, 4);
+    }
+    TW_ASSERT(TWMessageBarBlurTestMatchesReference(pixels, 32, 8, 6));
+    size_t changedCount = 0;
+    for (size_t i = 0; i < 32 * 8; i++)
+    {
+        changedCount += memcmp(pixels + (i * 4), (const uint8_t[]){40, 80, 120, 200}, 4) != 0;
+    }
+    TW_ASSERT_EQUAL(changedCount, 0);
+}
+
+static void TWMessageBarTestBlurIgnoresPartialBlocks(void)
+{
+    uint8_t pixels[6 * 4 * 4];
+    uint8_t original[sizeof(pixels)];
+    TWMessageBarBlurTestFillPremultiplied(pixels, 6 * 4);
+    memcpy(original, pixels, sizeof(pixels));
+    uint8_t scratch[1024] __attribute__((aligned(64)));
+    TWMessageBarBoxBlur(pixels, 6, 4, 2, scratch);
+    TW_ASSERT(memcmp(pixels, original, sizeof(pixels)) == 0);
+}
+
+int main(void)
+{
+    TW_RUN_TEST(TWMessageBarTestFixedPointDivideStaysClose);
+    TW_RUN_TEST(TWMessageBarTestBlurMatchesReference);
+    TW_RUN_TEST(TWMessageBarTestBlurKeepsFlatColor);
+    TW_RUN_TEST(TWMessageBarTestBlurIgnoresPartialBlocks);
+    return TWMessageBarTestFailureCount > 0 ? 1 : 0;
+}
@@ -0,0 +1,580 @@
+//
+//  TWMessageBarSimulation.c
+//
+//  Created by Terry Worona on 5/13/13.
+//  Copyright (c) 2013 Terry Worona. All rights reserved.
+//
+
+#include "TWMessageBarSimulation.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Mirrors kTWMessageBarAnimatorPositionTolerance and kTWMessageBarAnimatorVelocityTolerance
+#define TW_SIMULATION_POSITION_TOLERANCE 0.5
+#define TW_SIMULATION_VELOCITY_TOLERANCE 10.0
+
+// Every allocation is counted as malloc hands it out: rounded up to its 16 byte quantum
+#define TW_SIMULATION_ALLOCATION_QUANTUM 16
+
+typedef enum {
+    TWMessageBarSimulationEventProduce,
+    TWMessageBarSimulationEventVisible, // slide in (or fade in) finished
+    TWMessageBarSimulationEventDismiss, // display timer fired
+    TWMessageBarSimulationEventRemove // slide out (or fade out) finished
+} TWMessageBarSimulationEventKind;
+
+/*
+ * Timer payloads. Each message and producer embeds one per kind of timer it can have pending,
+ * so cancelling by payload identity always finds the right one.
+ */
+typedef struct {
+    TWMessageBarSimulationEventKind kind;
+    void *owner;
+} TWMessageBarSimulationEvent;
+
+/*
+ * What the manager keeps per message: the TWMessageBarMessage values (public and private) and its strings.
+ * The originals stay for coalescing; clamped copies exist only when clamping cut something. Once a bar is
+ * presented its view holds the same strings, so the descriptor stands in for it until the bar is removed.
+ */
+typedef struct {
+    void *isa; // object header
+    uint16_t *title;
+    uint16_t *messageDescription;
+    uint16_t *clampedTitle; // title itself when nothing was cut
+    uint16_t *clampedDescription;
+    size_t titleLength;
+    size_t descriptionLength;
+    TWMessageBarTextMeasurement titleMeasurement;
+    TWMessageBarTextMeasurement descriptionMeasurement;
+    double duration;
+    long priority;
+    long statusBarStyle;
+    int statusBarHidden;
+    TWMessageBarMessageOverrides overrides;
+    uint64_t identifier;
+    uint64_t enqueueTimestamp;
+    void *callback;
+} TWMessageBarSimulationDescriptor;
+
+typedef struct {
+    size_t identifier;
+    long priority;
+    TWMessageBarSimulationDescriptor *descriptor; // NULL once the message is gone
+    double enqueueTime;
+    double restingOffset;
+    int onScreen;
+    int visible;
+    int hit;
+    int handedOff; // gave up its slot as its dismissal started
+    TWMessageBarSimulationEvent visibleEvent;
+    TWMessageBarSimulationEvent dismissEvent;
+    TWMessageBarSimulationEvent removeEvent;
+} TWMessageBarSimulationMessage;
+
+typedef struct {
+    const TWMessageBarProducer *producer;
+    size_t performedCount;
+    TWMessageBarSimulationEvent event;
+} TWMessageBarSimulationProducerState;
+
+typedef struct {
+    const TWMessageBarSimulationConfiguration *configuration;
+    TWMessageBarSimulationResult *result;
+    double time;
+    TWMessageBarQueue queue;
+    TWMessageBarTimerQueue timers;
+    TWMessageBarSimulationMessage *messages;
+    TWMessageBarSimulationMessage **visibleMessages; // top to bottom; bars leaving in place stay until removed
+    size_t visibleCount;
+    size_t slotCount;
+    double *heights;
+    double *offsets;
+    uint16_t *text; // the caller's strings every message copies; not counted
+    size_t liveBytes;
+    size_t liveMessageCount;
+    size_t accountedQueueBytes;
+    int failed;
+} TWMessageBarSimulation;
+
+// Configuration
+TWMessageBarSimulationConfiguration TWMessageBarSimulationConfigurationDefault(void)
+{
+    TWMessageBarSimulationConfiguration configuration;
+    memset(&configuration, 0, sizeof(configuration));
+    configuration.maximumVisibleMessages = 1;
+    configuration.handoffMode = TWMessageBarHandoffModeSequential;
+    configuration.displayDuration = 3.0;
+    configuration.dismissAnimationDuration = 0.25;
+    configuration.frameInterval = 1.0 / 60.0;
+    configuration.barHeight = 64.0;
+    configuration.statusBarInset = 20.0;
+    configuration.stackCardPeek = 6.0;
+    configuration.titleLength = 24;
+    configuration.descriptionLength = 96;
+    return configuration;
+}
+
+// Timing
+static double TWMessageBarSimulationSlideDuration(const TWMessageBarSimulation *simulation, double from, double to)
+{
+    // Whole frames of the animator's spring on the virtual clock
+    const TWMessageBarSimulationConfiguration *configuration = simulation->configuration;
+    TWMessageBarSpring spring = TWMessageBarSpringMake(from, 0.0, to, configuration->dismissAnimationDuration);
+    size_t frameCount = 0;
+    do
+    {
+        TWMessageBarSpringStep(&spring, configuration->frameInterval);
+        frameCount++;
+    } while (!TWMessageBarSpringIsSettled(&spring, TW_SIMULATION_POSITION_TOLERANCE, TW_SIMULATION_VELOCITY_TOLERANCE));
+    return frameCount * configuration->frameInterval;
+}
+
+static void TWMessageBarSimulationScheduleAt(TWMessageBarSimulation *simulation, double fireTime, TWMessageBarSimulationEvent *event)
+{
+    if (!TWMessageBarTimerQueueSchedule(&simulation->timers, fireTime, event))
+    {
+        simulation->failed = 1;
+    }
+}
+
+static uint64_t TWMessageBarSimulationMicroseconds(double interval)
+{
+    return interval > 0.0 ? (uint64_t)llround(interval * 1e6) : 0;
+}
+
+// Memory
+static size_t TWMessageBarSimulationAllocationSize(size_t size)
+{
+    return (size + TW_SIMULATION_ALLOCATION_QUANTUM - 1) & ~(size_t)(TW_SIMULATION_ALLOCATION_QUANTUM - 1);
+}
+
+static void TWMessageBarSimulationRecordPeak(TWMessageBarSimulation *simulation)
+{
+    TWMessageBarSimulationResult *result = simulation->result;
+    if (simulation->liveBytes > result->peakBytes)
+    {
+        result->peakBytes = simulation->liveBytes;
+        result->peakMessageCount = simulation->liveMessageCount;
+    }
+}
+
+static void *TWMessageBarSimulationAllocate(TWMessageBarSimulation *simulation, size_t size)
+{
+    void *pointer = malloc(size);
+    if (!pointer)
+    {
+        simulation->failed = 1;
+        return NULL;
+    }
+    simulation->liveBytes += TWMessageBarSimulationAllocationSize(size);
+    TWMessageBarSimulationRecordPeak(simulation);
+    return pointer;
+}
+
+static void TWMessageBarSimulationDeallocate(TWMessageBarSimulation *simulation, void *pointer, size_t size)
+{
+    if (pointer)
+    {
+        simulation->liveBytes -= TWMessageBarSimulationAllocationSize(size);
+        free(pointer);
+    }
+}
+
+static void TWMessageBarSimulationAccountQueue(TWMessageBarSimulation *simulation)
+{
+    // The ring grows inside the core; its storage is counted whenever its capacity may have changed
+    size_t queueBytes = TWMessageBarSimulationAllocationSize(simulation->queue.capacity * sizeof(TWMessageBarQueueEntry));
+    simulation->liveBytes = simulation->liveBytes - simulation->accountedQueueBytes + queueBytes;
+    simulation->accountedQueueBytes = queueBytes;
+    TWMessageBarSimulationRecordPeak(simulation);
+}
+
+static uint16_t *TWMessageBarSimulationCopyString(TWMessageBarSimulation *simulation, size_t length)
+{
+    uint16_t *string = TWMessageBarSimulationAllocate(simulation, (length > 0 ? length : 1) * sizeof(uint16_t));
+    if (string)
+    {
+        memcpy(string, simulation->text, length * sizeof(uint16_t));
+    }
+    return string;
+}
+
+static void TWMessageBarSimulationDestroyDescriptor(TWMessageBarSimulation *simulation, TWMessageBarSimulationMessage *message)
+{
+    TWMessageBarSimulationDescriptor *descriptor = message->descriptor;
+    if (!descriptor)
+    {
+        return;
+    }
+    if (descriptor->clampedTitle != descriptor->title)
+    {
+        TWMessageBarSimulationDeallocate(simulation, descriptor->clampedTitle, descriptor->titleMeasurement.length * sizeof(uint16_t));
+    }
+    if (descriptor->clampedDescription != descriptor->messageDescription)
+    {
+        TWMessageBarSimulationDeallocate(simulation, descriptor->clampedDescription, descriptor->descriptionMeasurement.length * sizeof(uint16_t));
+    }
+    TWMessageBarSimulationDeallocate(simulation, descriptor->title, (descriptor->titleLength > 0 ? descriptor->titleLength : 1) * sizeof(uint16_t));
+    TWMessageBarSimulationDeallocate(simulation, descriptor->messageDescription, (descriptor->descriptionLength > 0 ? descriptor->descriptionLength : 1) * sizeof(uint16_t));
+    TWMessageBarSimulationDeallocate(simulation, descriptor, sizeof(*descriptor));
+    message->descriptor = NULL;
+    simulation->liveMessageCount--;
+}
+
+static uint16_t *TWMessageBarSimulationClampString(TWMessageBarSimulation *simulation, uint16_t *string, size_t length, TWMessageBarTextMeasurement *measurement)
+{
+    // The default style sheet's caps, through the same measurement as -[TWMessageView clampedString:...]
+    *measurement = TWMessageBarTextMeasure(string, length, TW_TEXT_MAXIMUM_CHARACTERS, TW_TEXT_MAXIMUM_LINES);
+    if (measurement->length == length)
+    {
+        return string;
+    }
+    uint16_t *clampedString = TWMessageBarSimulationAllocate(simulation, (measurement->length > 0 ? measurement->length : 1) * sizeof(uint16_t));
+    if (clampedString)
+    {
+        memcpy(clampedString, string, measurement->length * sizeof(uint16_t));
+    }
+    return clampedString;
+}
+
+static int TWMessageBarSimulationCreateDescriptor(TWMessageBarSimulation *simulation, TWMessageBarSimulationMessage *message)
+{
+    const TWMessageBarSimulationConfiguration *configuration = simulation->configuration;
+    TWMessageBarSimulationDescriptor *descriptor = TWMessageBarSimulationAllocate(simulation, sizeof(*descriptor));
+    if (!descriptor)
+    {
+        return 0;
+    }
+    memset(descriptor, 0, sizeof(*descriptor));
+    message->descriptor = descriptor;
+    simulation->liveMessageCount++;
+    
+    descriptor->identifier = message->identifier;
+    descriptor->priority = message->priority;
+    descriptor->duration = configuration->displayDuration;
+    descriptor->enqueueTimestamp = TWMessageBarSimulationMicroseconds(simulation->time);
+    descriptor->titleLength = configuration->titleLength;
+    descriptor->descriptionLength = configuration->descriptionLength;
+    descriptor->title = TWMessageBarSimulationCopyString(simulation, configuration->titleLength);
+    descriptor->messageDescription = TWMessageBarSimulationCopyString(simulation, configuration->descriptionLength);
+    if (!descriptor->title || !descriptor->messageDescription)
+    {
+        return 0;
+    }
+    descriptor->clampedTitle = TWMessageBarSimulationClampString(simulation, descriptor->title, descriptor->titleLength, &descriptor->titleMeasurement);
+    descriptor->clampedDescription = TWMessageBarSimulationClampString(simulation, descriptor->messageDescription, descriptor->descriptionLength, &descriptor->descriptionMeasurement);
+    return descriptor->clampedTitle && descriptor->clampedDescription;
+}
+
+// Presentation
+static void TWMessageBarSimulationLayout(TWMessageBarSimulation *simulation, size_t index)
+{
+    const TWMessageBarSimulationConfiguration *configuration = simulation->configuration;
+    for (size_t i = 0; i < simulation->visibleCount; i++)
+    {
+        simulation->heights[i] = configuration->barHeight;
+        simulation->offsets[i] = simulation->visibleMessages[i]->restingOffset;
+    }
+    TWMessageBarStackLayout(simulation->heights, simulation->offsets, simulation->visibleCount, index, configuration->statusBarInset, configuration->stackCardPeek, configuration->collapsed);
+    for (size_t i = index; i < simulation->visibleCount; i++)
+    {
+        simulation->visibleMessages[i]->restingOffset = simulation->offsets[i];
+    }
+}
+
+static void TWMessageBarSimulationPresent(TWMessageBarSimulation *simulation, TWMessageBarSimulationMessage *message, int fadeIn)
+{
+    const TWMessageBarSimulationConfiguration *configuration = simulation->configuration;
+    TWMessageBarSimulationResult *result = simulation->result;
+    
+    TWMessageBarHistogramRecord(&result->timeInQueue, TWMessageBarSimulationMicroseconds(simulation->time - message->enqueueTime));
+    result->presentationOrder[result->presentedCount++] = message->identifier;
+    
+    message->onScreen = 1;
+    simulation->visibleMessages[simulation->visibleCount++] = message;
+    
+    /*
+     * Slide in from above to the bar's place in the stack, or fade in place. Reflows while a bar is
+     * still sliding in retarget its spring but don't move the moment it comes to rest here.
+     */
+    double slideDuration = configuration->dismissAnimationDuration;
+    if (fadeIn)
+    {
+        message->restingOffset = 0.0;
+    }
+    else
+    {
+        TWMessageBarSimulationLayout(simulation, simulation->visibleCount - 1);
+        slideDuration = TWMessageBarSimulationSlideDuration(simulation, -configuration->barHeight, message->restingOffset);
+    }
+    TWMessageBarSimulationScheduleAt(simulation, simulation->time + slideDuration, &message->visibleEvent);
+    
+    // The display timer starts with the presentation, not once the bar comes to rest
+    TWMessageBarSimulationScheduleAt(simulation, simulation->time + configuration->displayDuration, &message->dismissEvent);
+}
+
+static void TWMessageBarSimulationShowNext(TWMessageBarSimulation *simulation, int fadeIn)
+{
+    TWMessageBarSimulationResult *result = simulation->result;
+    while (simulation->queue.count > 0 && simulation->visibleCount < simulation->slotCount)
+    {
+        TWMessageBarSimulationMessage *message = TWMessageBarQueueDequeue(&simulation->queue);
+        if (simulation->queue.count > 0)
+        {
+            const TWMessageBarSimulationMessage *next = TWMessageBarQueuePayloadAtIndex(&simulation->queue, 0);
+            if (next->priority > message->priority || (next->priority == message->priority && next->identifier < message->identifier))
+            {
+                result->orderViolationCount++;
+            }
+        }
+        TWMessageBarSimulationPresent(simulation, message, fadeIn);
+    }
+}
+
+static void TWMessageBarSimulationRemoveVisibleMessage(TWMessageBarSimulation *simulation, const TWMessageBarSimulationMessage *message)
+{
+    for (size_t i = 0; i < simulation->visibleCount; i++)
+    {
+        if (simulation->visibleMessages[i] == message)
+        {
+            memmove(&simulation->visibleMessages[i], &simulation->visibleMessages[i + 1], (simulation->visibleCount - i - 1) * sizeof(*simulation->visibleMessages));
+            simulation->visibleCount--;
+            TWMessageBarSimulationLayout(simulation, i);
+            return;
+        }
+    }
+}
+
+// Dismissal
+static void TWMessageBarSimulationDismiss(TWMessageBarSimulation *simulation, TWMessageBarSimulationMessage *message, int tapped)
+{
+    const TWMessageBarSimulationConfiguration *configuration = simulation->configuration;
+    TWMessageBarSimulationResult *result = simulation->result;
+    
+    message->hit = 1;
+    TWMessageBarTimerQueueCancel(&simulation->timers, &message->dismissEvent);
+    TWMessageBarTimerQueueCancel(&simulation->timers, &message->visibleEvent); // dismissed mid slide in; it never rests
+    if (tapped)
+    {
+        result->tappedCount++;
+    }
+    else
+    {
+        result->timedOutCount++;
+    }
+    
+    TWMessageBarSlotRelease slotRelease = TWMessageBarSlotReleaseForDismissal(configuration->handoffMode, configuration->maximumVisibleMessages, simulation->queue.count);
+    double removeDuration = slotRelease == TWMessageBarSlotReleaseOnDismissalCrossFading ? configuration->dismissAnimationDuration : TWMessageBarSimulationSlideDuration(simulation, message->restingOffset, -configuration->barHeight);
+    TWMessageBarSimulationScheduleAt(simulation, simulation->time + removeDuration, &message->removeEvent);
+    
+    if (slotRelease != TWMessageBarSlotReleaseOnRemoval)
+    {
+        message->handedOff = 1;
+        TWMessageBarSimulationRemoveVisibleMessage(simulation, message);
+        TWMessageBarSimulationShowNext(simulation, slotRelease == TWMessageBarSlotReleaseOnDismissalCrossFading);
+    }
+}
+
+static void TWMessageBarSimulationRemove(TWMessageBarSimulation *simulation, TWMessageBarSimulationMessage *message)
+{
+    message->onScreen = 0;
+    simulation->result->drainTime = simulation->time;
+    TWMessageBarSimulationDestroyDescriptor(simulation, message);
+    if (!message->handedOff)
+    {
+        TWMessageBarSimulationRemoveVisibleMessage(simulation, message);
+        TWMessageBarSimulationShowNext(simulation, 0);
+    }
+}
+
+// Producers
+static void TWMessageBarSimulationEnqueue(TWMessageBarSimulation *simulation, long priority)
+{
+    TWMessageBarSimulationResult *result = simulation->result;
+    TWMessageBarSimulationMessage *message = &simulation->messages[result->enqueuedCount];
+    message->identifier = result->enqueuedCount++;
+    message->priority = priority;
+    message->enqueueTime = simulation->time;
+    
+    if (!TWMessageBarSimulationCreateDescriptor(simulation, message) || !TWMessageBarQueueEnqueue(&simulation->queue, message, priority))
+    {
+        simulation->failed = 1;
+        return;
+    }
+    TWMessageBarSimulationAccountQueue(simulation);
+    if (simulation->queue.count > result->maximumQueueDepth)
+    {
+        result->maximumQueueDepth = simulation->queue.count;
+    }
+    if (simulation->accountedQueueBytes > result->maximumQueueBytes)
+    {
+        result->maximumQueueBytes = simulation->accountedQueueBytes;
+    }
+    
+    TWMessageBarSimulationShowNext(simulation, 0);
+}
+
+static void TWMessageBarSimulationTap(TWMessageBarSimulation *simulation)
+{
+    for (size_t i = 0; i < simulation->visibleCount; i++)
+    {
+        if (!simulation->visibleMessages[i]->hit)
+        {
+            TWMessageBarSimulationDismiss(simulation, simulation->visibleMessages[i], 1);
+            return;
+        }
+    }
+}
+
+static void TWMessageBarSimulationHideAll(TWMessageBarSimulation *simulation)
+{
+    TWMessageBarSimulationResult *result = simulation->result;
+    result->discardedCount += simulation->queue.count + simulation->visibleCount;
+    for (size_t i = 0; i < simulation->queue.count; i++)
+    {
+        TWMessageBarSimulationDestroyDescriptor(simulation, TWMessageBarQueuePayloadAtIndex(&simulation->queue, i));
+    }
+    TWMessageBarQueueRemoveAll(&simulation->queue);
+    TWMessageBarSimulationAccountQueue(simulation);
+    simulation->visibleCount = 0;
+    
+    // Every bar on screen, outgoing ones included, leaves at once
+    for (size_t i = 0; i < result->enqueuedCount; i++)
+    {
+        TWMessageBarSimulationMessage *message = &simulation->messages[i];
+        if (message->onScreen)
+        {
+            TWMessageBarTimerQueueCancel(&simulation->timers, &message->visibleEvent);
+            TWMessageBarTimerQueueCancel(&simulation->timers, &message->dismissEvent);
+            TWMessageBarTimerQueueCancel(&simulation->timers, &message->removeEvent);
+            message->onScreen = 0;
+            message->hit = 1;
+            result->drainTime = simulation->time;
+            TWMessageBarSimulationDestroyDescriptor(simulation, message);
+        }
+    }
+}
+
+static void TWMessageBarSimulationProduce(TWMessageBarSimulation *simulation, TWMessageBarSimulationProducerState *state)
+{
+    const TWMessageBarProducer *producer = state->producer;
+    switch (producer->action)
+    {
+        case TWMessageBarSimulationActionShow:
+            TWMessageBarSimulationEnqueue(simulation, producer->priority);
+            break;
+        case TWMessageBarSimulationActionTap:
+            TWMessageBarSimulationTap(simulation);
+            break;
+        case TWMessageBarSimulationActionHideAll:
+            TWMessageBarSimulationHideAll(simulation);
+            break;
+    }
+    
+    state->performedCount++;
+    if (state->performedCount < producer->count)
+    {
+        TWMessageBarSimulationScheduleAt(simulation, producer->startTime + (state->performedCount * producer->interval), &state->event);
+    }
+}
+
+// Run
+int TWMessageBarSimulationRun(const TWMessageBarSimulationConfiguration *configuration, const TWMessageBarProducer *producers, size_t producerCount, TWMessageBarSimulationResult *result)
+{
+    memset(result, 0, sizeof(*result));
+    
+    size_t messageCount = 0;
+    for (size_t i = 0; i < producerCount; i++)
+    {
+        if (producers[i].action == TWMessageBarSimulationActionShow)
+        {
+            messageCount += producers[i].count;
+        }
+    }
+    
+    TWMessageBarSimulation simulation;
+    memset(&simulation, 0, sizeof(simulation));
+    simulation.configuration = configuration;
+    simulation.result = result;
+    simulation.slotCount = configuration->maximumVisibleMessages > 1 ? configuration->maximumVisibleMessages : 1;
+    simulation.messages = calloc(messageCount + 1, sizeof(*simulation.messages));
+    simulation.visibleMessages = calloc(simulation.slotCount, sizeof(*simulation.visibleMessages));
+    simulation.heights = calloc(simulation.slotCount, sizeof(*simulation.heights));
+    simulation.offsets = calloc(simulation.slotCount, sizeof(*simulation.offsets));
+    result->presentationOrder = calloc(messageCount + 1, sizeof(*result->presentationOrder));
+    TWMessageBarSimulationProducerState *states = calloc(producerCount + 1, sizeof(*states));
+    size_t textLength = configuration->titleLength > configuration->descriptionLength ? configuration->titleLength : configuration->descriptionLength;
+    simulation.text = malloc((textLength > 0 ? textLength : 1) * sizeof(uint16_t));
+    simulation.failed = !simulation.messages || !simulation.visibleMessages || !simulation.heights || !simulation.offsets || !result->presentationOrder || !states || !simulation.text;
+    
+    if (!simulation.failed)
+    {
+        for (size_t i = 0; i < textLength; i++)
+        {
+            simulation.text[i] = (uint16_t)(i % 8 == 7 ? ' ' : 'a' + (i % 26)); // short words, one line
+        }
+        for (size_t i = 0; i < messageCount; i++)
+        {
+            TWMessageBarSimulationMessage *message = &simulation.messages[i];
+            message->visibleEvent = (TWMessageBarSimulationEvent){TWMessageBarSimulationEventVisible, message};
+            message->dismissEvent = (TWMessageBarSimulationEvent){TWMessageBarSimulationEventDismiss, message};
+            message->removeEvent = (TWMessageBarSimulationEvent){TWMessageBarSimulationEventRemove, message};
+        }
+        for (size_t i = 0; i < producerCount; i++)
+        {
+            states[i].producer = &producers[i];
+            states[i].event = (TWMessageBarSimulationEvent){TWMessageBarSimulationEventProduce, &states[i]};
+            if (producers[i].count > 0)
+            {
+                TWMessageBarSimulationScheduleAt(&simulation, producers[i].startTime, &states[i].event);
+            }
+        }
+    }
+    
+    TWMessageBarTimer timer;
+    while (!simulation.failed && TWMessageBarTimerQueuePopDue(&simulation.timers, INFINITY, &timer))
+    {
+        simulation.time = timer.fireTime;
+        TWMessageBarSimulationEvent *event = timer.payload;
+        TWMessageBarSimulationMessage *message = event->owner;
+        switch (event->kind)
+        {
+            case TWMessageBarSimulationEventProduce:
+                TWMessageBarSimulationProduce(&simulation, event->owner);
+                break;
+            case TWMessageBarSimulationEventVisible:
+                message->visible = 1;
+                TWMessageBarHistogramRecord(&result->timeToVisible, TWMessageBarSimulationMicroseconds(simulation.time - message->enqueueTime));
+                break;
+            case TWMessageBarSimulationEventDismiss:
+                TWMessageBarSimulationDismiss(&simulation, message, 0);
+                break;
+            case TWMessageBarSimulationEventRemove:
+                TWMessageBarSimulationRemove(&simulation, message);
+                break;
+        }
+    }
+    
+    for (size_t i = 0; simulation.messages && i < result->enqueuedCount; i++)
+    {
+        TWMessageBarSimulationDestroyDescriptor(&simulation, &simulation.messages[i]);
+    }
+    TWMessageBarQueueRemoveAll(&simulation.queue);
+    TWMessageBarTimerQueueRemoveAll(&simulation.timers);
+    free(simulation.text);
+    free(simulation.messages);
+    free(simulation.visibleMessages);
+    free(simulation.heights);
+    free(simulation.offsets);
+    free(states);
+    return !simulation.failed;
+}
+
+void TWMessageBarSimulationResultFree(TWMessageBarSimulationResult *result)
+{
+    free(result->presentationOrder);
+    result->presentationOrder = NULL;
+}
@@ -0,0 +1,103 @@
+//
+//  TWMessageBarSimulation.h
+//
+//  Created by Terry Worona on 5/13/13.
+//  Copyright (c) 2013 Terry Worona. All rights reserved.
+//
+//  A model of the manager's scheduling on a virtual clock, NOT the manager itself. It shares the core pieces with
+//  TWMessageBarManager (queue, timer heap, stack layout, spring, slot release rule, text measurement), but the
+//  present/dismiss/slot state machine around them is a C re-implementation of the manager's and has to be kept in
+//  step with it by hand. What it leaves out:
+//
+//  - Views: bars are timings and a fixed height; no style sheet, text system or status bar.
+//  - Coalescing and per-message overrides; every message uses the configuration's duration.
+//  - hideAll is instant, where the manager slides the bars out.
+//  - Memory is the message descriptors, their strings and the queue, standing in for the view while on screen.
+//
+//  Its results say how the scheduling behaves, and only as far as the model matches the manager.
+//
+
+#ifndef TWMessageBarSimulation_h
+#define TWMessageBarSimulation_h
+
+#include "TWMessageBarCore.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Configuration
+
+typedef struct {
+    size_t maximumVisibleMessages;
+    TWMessageBarHandoffMode handoffMode;
+    int collapsed; // card stack rather than vertical
+    double displayDuration; // seconds on screen before the dismiss timer fires
+    double dismissAnimationDuration; // spring settle time and cross-fade length
+    double frameInterval; // animation frames on the virtual clock
+    double barHeight;
+    double statusBarInset;
+    double stackCardPeek;
+    size_t titleLength; // UTF-16 units in every message's title
+    size_t descriptionLength;
+} TWMessageBarSimulationConfiguration;
+
+/**
+ *  The manager's defaults: a single sequential bar, 3s on screen, 0.25s animations at 60 frames per second.
+ *  Messages have a 24 unit title and a 96 unit description.
+ */
+TWMessageBarSimulationConfiguration TWMessageBarSimulationConfigurationDefault(void);
+
+// Producers
+
+typedef enum {
+    TWMessageBarSimulationActionShow, // enqueues a message
+    TWMessageBarSimulationActionTap, // taps the front bar that isn't already leaving
+    TWMessageBarSimulationActionHideAll // hides every bar and discards the queue
+} TWMessageBarSimulationAction;
+
+/**
+ *  Performs `action` `count` times, starting at `startTime` and then every `interval` seconds.
+ *  A zero interval is a burst: every action lands at the same instant, in order.
+ */
+typedef struct {
+    TWMessageBarSimulationAction action;
+    double startTime;
+    double interval;
+    size_t count;
+    long priority; // shows only
+} TWMessageBarProducer;
+
+// Results
+
+typedef struct {
+    size_t enqueuedCount;
+    size_t presentedCount;
+    size_t tappedCount;
+    size_t timedOutCount;
+    size_t discardedCount; // queued or on screen when everything was hidden
+    size_t orderViolationCount; // presentations that overtook a message queued ahead of them
+    size_t maximumQueueDepth;
+    size_t maximumQueueBytes; // queue storage at its largest
+    size_t peakBytes; // message descriptors, their strings and queue storage at their largest, as allocated
+    size_t peakMessageCount; // messages queued or on screen at that point
+    double drainTime; // when the last bar left the screen
+    TWMessageBarHistogram timeInQueue; // microseconds from enqueue to presentation
+    TWMessageBarHistogram timeToVisible; // microseconds from enqueue to resting on screen
+    size_t *presentationOrder; // message identifiers (their enqueue order) as they were presented
+} TWMessageBarSimulationResult;
+
+/**
+ *  Replays the producers until nothing is left on screen or scheduled.
+ *
+ *  @return Zero if memory ran out; the result is then incomplete.
+ */
+int TWMessageBarSimulationRun(const TWMessageBarSimulationConfiguration *configuration, const TWMessageBarProducer *producers, size_t producerCount, TWMessageBarSimulationResult *result);
+
+void TWMessageBarSimulationResultFree(TWMessageBarSimulationResult *result);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,243 @@
+//
+//  TWMessageBarSimulationTests.c
+//
+//  Created by Terry Worona on 5/13/13.
+//  Copyright (c) 2013 Terry Worona. All rights reserved.
+//
+//  Scheduling tests against the simulation. It models the manager rather than running it (see
+//  TWMessageBarSimulation.h), so these hold the model and the shared core to the expected behaviour.
+//
+
+#include "TWMessageBarSimulation.h"
+#include "TWMessageBarTest.h"
+
+#define TW_PRODUCER_COUNT(producers) (sizeof(producers) / sizeof(*(producers)))
+#define TW_STRESS_MESSAGE_COUNT 100000
+#define TW_STRESS_BYTES_PER_MESSAGE_BUDGET 512 // descriptor, a 24 unit title, a 96 unit description and a queue entry
+#define TW_STRESS_LONG_TEXT_LENGTH (4 * TW_TEXT_MAXIMUM_CHARACTERS)
+
+static uint64_t TWMessageBarTestPercentile(const TWMessageBarHistogram *histogram, double percentile)
+{
+    uint64_t value = 0;
+    TWMessageBarHistogramValuesAtPercentiles(histogram, &percentile, &value, 1);
+    return value;
+}
+
+// Timing
+
+static void TWMessageBarTestSingleMessageTimesOut(void)
+{
+    TWMessageBarSimulationConfiguration configuration = TWMessageBarSimulationConfigurationDefault();
+    TWMessageBarProducer producers[] = {
+        {TWMessageBarSimulationActionShow, 0.0, 0.0, 1, 0}
+    };
+    TWMessageBarSimulationResult result;
+    TW_ASSERT(TWMessageBarSimulationRun(&configuration, producers, TW_PRODUCER_COUNT(producers), &result));
+    
+    TW_ASSERT_EQUAL(result.presentedCount, 1);
+    TW_ASSERT_EQUAL(result.timedOutCount, 1);
+    TW_ASSERT_EQUAL(result.discardedCount, 0);
+    
+    // Rests within a couple of animation lengths; leaves one slide after the display timer
+    TW_ASSERT(result.timeToVisible.maximum > 0 && result.timeToVisible.maximum <= 500000);
+    TW_ASSERT(result.drainTime > configuration.displayDuration && result.drainTime <= configuration.displayDuration + 0.5);
+    TWMessageBarSimulationResultFree(&result);
+}
+
+// Ordering
+
+static void TWMessageBarTestPriorityOvertakesQueuedMessages(void)
+{
+    TWMessageBarSimulationConfiguration configuration = TWMessageBarSimulationConfigurationDefault();
+    TWMessageBarProducer producers[] = {
+        {TWMessageBarSimulationActionShow, 0.0, 0.0, 5, 0},
+        {TWMessageBarSimulationActionShow, 1.0, 0.0, 2, 1}
+    };
+    TWMessageBarSimulationResult result;
+    TW_ASSERT(TWMessageBarSimulationRun(&configuration, producers, TW_PRODUCER_COUNT(producers), &result));
+    
+    // The first message is already on screen; the urgent pair goes next, in order, then the rest of the burst
+    size_t expectedOrder[] = {0, 5, 6, 1, 2, 3, 4};
+    TW_ASSERT_EQUAL(result.presentedCount, 7);
+    for (size_t i = 0; i < result.presentedCount && i < 7; i++)
+    {
+        TW_ASSERT_EQUAL(result.presentationOrder[i], expectedOrder[i]);
+    }
+    TW_ASSERT_EQUAL(result.orderViolationCount, 0);
+    TWMessageBarSimulationResultFree(&result);
+}
+
+// Taps and drops
+
+static void TWMessageBarTestTapsDismissEachBar(void)
+{
+    TWMessageBarSimulationConfiguration configuration = TWMessageBarSimulationConfigurationDefault();
+    TWMessageBarProducer producers[] = {
+        {TWMessageBarSimulationActionShow, 0.0, 0.0, 10, 0},
+        {TWMessageBarSimulationActionTap, 0.1, 0.5, 10, 0}
+    };
+    TWMessageBarSimulationResult result;
+    TW_ASSERT(TWMessageBarSimulationRun(&configuration, producers, TW_PRODUCER_COUNT(producers), &result));
+    
+    TW_ASSERT_EQUAL(result.presentedCount, 10);
+    TW_ASSERT_EQUAL(result.tappedCount, 10);
+    TW_ASSERT_EQUAL(result.timedOutCount, 0);
+    TW_ASSERT(result.drainTime < 10 * 0.5 + 0.5);
+    TWMessageBarSimulationResultFree(&result);
+}
+
+static void TWMessageBarTestHideAllDiscardsQueue(void)
+{
+    TWMessageBarSimulationConfiguration configuration = TWMessageBarSimulationConfigurationDefault();
+    TWMessageBarProducer producers[] = {
+        {TWMessageBarSimulationActionShow, 0.0, 0.0, 10, 0},
+        {TWMessageBarSimulationActionHideAll, 1.0, 0.0, 1, 0},
+        {TWMessageBarSimulationActionShow, 2.0, 0.0, 1, 0}
+    };
+    TWMessageBarSimulationResult result;
+    TW_ASSERT(TWMessageBarSimulationRun(&configuration, producers, TW_PRODUCER_COUNT(producers), &result));
+    
+    TW_ASSERT_EQUAL(result.enqueuedCount, 11);
+    TW_ASSERT_EQUAL(result.discardedCount, 10); // nine queued and the one on screen
+    TW_ASSERT_EQUAL(result.presentedCount, 2);
+    TW_ASSERT_EQUAL(result.presentationOrder[1], 10);
+    TW_ASSERT(result.drainTime > 2.0 + configuration.displayDuration);
+    TWMessageBarSimulationResultFree(&result);
+}
+
+// Replay
+
+static void TWMessageBarTestHourOfTrafficDrains(void)
+{
+    /*
+     * An hour of production-like traffic: a steady message every 20s, bursts of 20 every 10 minutes
+     * with an urgent message in each, and a user who taps something away every 45s.
+     */
+    TWMessageBarSimulationConfiguration configuration = TWMessageBarSimulationConfigurationDefault();
+    TWMessageBarProducer producers[] = {
+        {TWMessageBarSimulationActionShow, 0.0, 20.0, 180, 0},
+        {TWMessageBarSimulationActionShow, 300.0, 0.0, 20, 0},
+        {TWMessageBarSimulationActionShow, 900.0, 0.0, 20, 0},
+        {TWMessageBarSimulationActionShow, 1500.0, 0.0, 20, 0},
+        {TWMessageBarSimulationActionShow, 2100.0, 0.0, 20, 0},
+        {TWMessageBarSimulationActionShow, 2700.0, 0.0, 20, 0},
+        {TWMessageBarSimulationActionShow, 3300.0, 0.0, 20, 0},
+        {TWMessageBarSimulationActionShow, 305.0, 600.0, 6, 1},
+        {TWMessageBarSimulationActionTap, 10.0, 45.0, 80, 0}
+    };
+    TWMessageBarSimulationResult result;
+    TW_ASSERT(TWMessageBarSimulationRun(&configuration, producers, TW_PRODUCER_COUNT(producers), &result));
+    
+    TW_ASSERT_EQUAL(result.enqueuedCount, 180 + (6 * 20) + 6);
+    TW_ASSERT_EQUAL(result.presentedCount, result.enqueuedCount);
+    TW_ASSERT_EQUAL(result.discardedCount, 0);
+    TW_ASSERT_EQUAL(result.orderViolationCount, 0);
+    
+    // Every burst clears within two minutes, long before the next one arrives
+    TW_ASSERT(result.timeInQueue.maximum < 120 * 1000000ULL);
+    TW_ASSERT(TWMessageBarTestPercentile(&result.timeInQueue, 50.0) < 5 * 1000000ULL);
+    TW_ASSERT(result.drainTime < 3700.0);
+    TWMessageBarSimulationResultFree(&result);
+}
+
+// Hand-off and stacks
+
+static double TWMessageBarTestDrainTime(size_t maximumVisibleMessages, TWMessageBarHandoffMode handoffMode, size_t messageCount)
+{
+    TWMessageBarSimulationConfiguration configuration = TWMessageBarSimulationConfigurationDefault();
+    configuration.maximumVisibleMessages = maximumVisibleMessages;
+    configuration.handoffMode = handoffMode;
+    TWMessageBarProducer producers[] = {
+        {TWMessageBarSimulationActionShow, 0.0, 0.0, messageCount, 0}
+    };
+    TWMessageBarSimulationResult result;
+    TW_ASSERT(TWMessageBarSimulationRun(&configuration, producers, TW_PRODUCER_COUNT(producers), &result));
+    TW_ASSERT_EQUAL(result.presentedCount, messageCount);
+    TW_ASSERT_EQUAL(result.orderViolationCount, 0);
+    TWMessageBarSimulationResultFree(&result);
+    return result.drainTime;
+}
+
+static void TWMessageBarTestHandoffShortensDrain(void)
+{
+    double sequential = TWMessageBarTestDrainTime(1, TWMessageBarHandoffModeSequential, 10);
+    double crossSlide = TWMessageBarTestDrainTime(1, TWMessageBarHandoffModeCrossSlide, 10);
+    double crossFade = TWMessageBarTestDrainTime(1, TWMessageBarHandoffModeCrossFade, 10);
+    
+    // Overlapped hand-offs only pay for the last bar's exit
+    TW_ASSERT(sequential > crossSlide);
+    TW_ASSERT(crossSlide >= crossFade);
+    TW_ASSERT(crossFade >= 10 * 3.0 && crossFade <= 10 * 3.0 + 0.5);
+    TW_ASSERT(sequential >= 10 * 3.2);
+}
+
+static void TWMessageBarTestStackShortensDrain(void)
+{
+    double single = TWMessageBarTestDrainTime(1, TWMessageBarHandoffModeSequential, 12);
+    double stacked = TWMessageBarTestDrainTime(3, TWMessageBarHandoffModeSequential, 12);
+    
+    TW_ASSERT(stacked < single / 3.0);
+    TW_ASSERT(stacked >= 4 * 3.0);
+}
+
+// Stress
+
+static void TWMessageBarTestBurstStaysWithinBudget(void)
+{
+    // A buggy producer enqueues everything at once; the backlog drains one bar at a time, in order
+    TWMessageBarSimulationConfiguration configuration = TWMessageBarSimulationConfigurationDefault();
+    TWMessageBarProducer producers[] = {
+        {TWMessageBarSimulationActionShow, 0.0, 0.0, TW_STRESS_MESSAGE_COUNT, 0}
+    };
+    TWMessageBarSimulationResult result;
+    TW_ASSERT(TWMessageBarSimulationRun(&configuration, producers, TW_PRODUCER_COUNT(producers), &result));
+    
+    TW_ASSERT_EQUAL(result.maximumQueueDepth, TW_STRESS_MESSAGE_COUNT - 1);
+    TW_ASSERT_EQUAL(result.peakMessageCount, TW_STRESS_MESSAGE_COUNT);
+    TW_ASSERT(result.peakBytes <= result.peakMessageCount * TW_STRESS_BYTES_PER_MESSAGE_BUDGET);
+    
+    TW_ASSERT_EQUAL(result.presentedCount, TW_STRESS_MESSAGE_COUNT);
+    TW_ASSERT_EQUAL(result.discardedCount, 0);
+    TW_ASSERT_EQUAL(result.orderViolationCount, 0);
+    size_t outOfOrderCount = 0;
+    for (size_t i = 0; i < result.presentedCount; i++)
+    {
+        outOfOrderCount += result.presentationOrder[i] != i;
+    }
+    TW_ASSERT_EQUAL(outOfOrderCount, 0);
+    TW_ASSERT(result.drainTime < TW_STRESS_MESSAGE_COUNT * (configuration.displayDuration + 0.5));
+    TWMessageBarSimulationResultFree(&result);
+}
+
+static void TWMessageBarTestLongTextStaysWithinBudget(void)
+{
+    // Oversized strings are kept for coalescing; only their clamped copies are added, and those are bounded
+    TWMessageBarSimulationConfiguration configuration = TWMessageBarSimulationConfigurationDefault();
+    configuration.titleLength = TW_STRESS_LONG_TEXT_LENGTH;
+    configuration.descriptionLength = TW_STRESS_LONG_TEXT_LENGTH;
+    TWMessageBarProducer producers[] = {
+        {TWMessageBarSimulationActionShow, 0.0, 0.0, 1000, 0}
+    };
+    TWMessageBarSimulationResult result;
+    TW_ASSERT(TWMessageBarSimulationRun(&configuration, producers, TW_PRODUCER_COUNT(producers), &result));
+    
+    size_t textBytes = 2 * (TW_STRESS_LONG_TEXT_LENGTH + TW_TEXT_MAXIMUM_CHARACTERS) * sizeof(uint16_t);
+    TW_ASSERT_EQUAL(result.peakMessageCount, 1000);
+    TW_ASSERT(result.peakBytes > result.peakMessageCount * 2 * TW_STRESS_LONG_TEXT_LENGTH * sizeof(uint16_t));
+    TW_ASSERT(result.peakBytes <= result.peakMessageCount * (TW_STRESS_BYTES_PER_MESSAGE_BUDGET + textBytes));
+    TWMessageBarSimulationResultFree(&result);
+}
+
+int main(void)
+{
+    TW_RUN_TEST(TWMessageBarTestSingleMessageTimesOut);
+    TW_RUN_TEST(TWMessageBarTestPriorityOvertakesQueuedMessages);
+    TW_RUN_TEST(TWMessageBarTestTapsDismissEachBar);
+    TW_RUN_TEST(TWMessageBarTestHideAllDiscardsQueue);
+    TW_RUN_TEST(TWMessageBarTestHourOfTrafficDrains);
+    TW_RUN_TEST(TWMessageBarTestHandoffShortensDrain);
+    TW_RUN_TEST(TWMessageBarTestStackShortensDrain);
+    TW_RUN_TEST(TWMessageBarTestBurstStaysWithinBudget);
+    TW_RUN_TEST(TWMessageBarTestLongTextStaysWithinBudget);
+    return TWMessageBarTestFailureCount > 0 ? 1 : 0;
+}
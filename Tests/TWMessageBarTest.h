@@ -0,0 +1,44 @@
+//
+//  TWMessageBarTest.h
+//
+//  Created by Terry Worona on 5/13/13.
+//  Copyright (c) 2013 Terry Worona. All rights reserved.
+//
+//  Minimal assertions for the portable tests; each test executable returns non-zero if any of them failed.
+//
+
+#ifndef TWMessageBarTest_h
+#define TWMessageBarTest_h
+
+#include <stdio.h>
+
+static int TWMessageBarTestFailureCount = 0;
+
+#define TW_ASSERT(condition) \
+    do { \
+        if (!(condition)) \
+        { \
+            fprintf(stderr, "%s:%d: assertion failed: %s\n", __FILE__, __LINE__, #condition); \
+            TWMessageBarTestFailureCount++; \
+        } \
+    } while (0)
+
+#define TW_ASSERT_EQUAL(value, expected) \
+    do { \
+        long long twValue = (long long)(value); \
+        long long twExpected = (long long)(expected); \
+        if (twValue != twExpected) \
+        { \
+            fprintf(stderr, "%s:%d: %s is %lld, expected %lld\n", __FILE__, __LINE__, #value, twValue, twExpected); \
+            TWMessageBarTestFailureCount++; \
+        } \
+    } while (0)
+
+#define TW_RUN_TEST(test) \
+    do { \
+        int twFailureCount = TWMessageBarTestFailureCount; \
+        test(); \
+        fprintf(stderr, "%s %s\n", TWMessageBarTestFailureCount == twFailureCount ? "passed" : "FAILED", #test); \
+    } while (0)
+
+#endif
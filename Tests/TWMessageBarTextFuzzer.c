@@ -0,0 +1,237 @@
+//
+//  TWMessageBarTextFuzzer.c
+//
+//  Created by Terry Worona on 5/13/13.
+//  Copyright (c) 2013 Terry Worona. All rights reserved.
+//
+//  Fuzzes the text measurement the manager runs before the text system: TWMessageBarTextMeasure (clamp, line count
+//  and scan), the height bounds derived from it, and TWMessageBarTextScanCharacters against the scalar reference.
+//  Built against libFuzzer with TW_MESSAGE_BAR_LIBFUZZER (clang only); otherwise a standalone driver replays the files
+//  passed as arguments, or generated inputs when there are none.
+//
+
+#include "TWMessageBarCore.h"
+#include "TWMessageBarTextReference.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Numerics
+#define TW_FUZZER_MAXIMUM_UNITS (TW_TEXT_MAXIMUM_CHARACTERS * 4) // well past what a measurement may read
+#define TW_FUZZER_HEADER_SIZE 5
+#define TW_FUZZER_GENERATED_INPUT_COUNT 200000
+#define TW_FUZZER_HEIGHT_RATIO 0.5 // kTWMessageViewMaximumHeightRatio
+#define TW_FUZZER_PADDING 10.0 // kTWMessageViewBarPadding
+#define TW_FUZZER_MINIMUM_HEIGHT 36.0 // kTWMessageViewIconSize
+
+#define TW_FUZZER_CHECK(condition) \
+    do { \
+        if (!(condition)) \
+        { \
+            fprintf(stderr, "%s:%d: invariant failed: %s\n", __FILE__, __LINE__, #condition); \
+            abort(); \
+        } \
+    } while (0)
+
+static int TWMessageBarFuzzerIsLineBreak(uint16_t character)
+{
+    return character == '\n' || character == 0x2028;
+}
+
+static int TWMessageBarFuzzerIsHighSurrogate(uint16_t character)
+{
+    return character >= 0xD800 && character <= 0xDBFF;
+}
+
+static int TWMessageBarFuzzerIsLowSurrogate(uint16_t character)
+{
+    return character >= 0xDC00 && character <= 0xDFFF;
+}
+
+static void TWMessageBarFuzzerCheckScan(TWMessageBarTextScan scan, const uint16_t *characters, size_t length)
+{
+    TWMessageBarTextScan reference = TWMessageBarTextScanReference(characters, length);
+    TW_FUZZER_CHECK(scan.newlineCount == reference.newlineCount);
+    TW_FUZZER_CHECK(scan.asciiOnly == reference.asciiOnly);
+    TW_FUZZER_CHECK(scan.complex == reference.complex);
+}
+
+static void TWMessageBarFuzzerCheckClamp(const uint16_t *characters, size_t length, size_t clampedLength, size_t maximumCharacters, size_t maximumLines)
+{
+    size_t limit = length < maximumCharacters ? length : maximumCharacters;
+    
+    // Length: never past either the input or the character cap, and the same as the reference
+    TW_FUZZER_CHECK(clampedLength <= limit);
+    TW_FUZZER_CHECK(clampedLength == TWMessageBarTextClampedLengthReference(characters, length, maximumCharacters, maximumLines));
+    
+    // Lines: the prefix keeps within the line cap
+    size_t lineBreakCount = 0;
+    for (size_t i = 0; i < clampedLength; i++)
+    {
+        lineBreakCount += TWMessageBarFuzzerIsLineBreak(characters[i]);
+    }
+    TW_FUZZER_CHECK(lineBreakCount < maximumLines);
+    
+    // A shorter prefix is cut right before the line break that would start one line too many, or before a split pair
+    if (clampedLength < limit)
+    {
+        int lineCut = TWMessageBarFuzzerIsLineBreak(characters[clampedLength]) && lineBreakCount == maximumLines - 1;
+        int surrogateCut = clampedLength == limit - 1 && limit < length && TWMessageBarFuzzerIsHighSurrogate(characters[clampedLength]);
+        TW_FUZZER_CHECK(lineCut || surrogateCut);
+    }
+    
+    // Surrogates: a pair is never split by the cut
+    if (clampedLength > 0 && clampedLength < length)
+    {
+        TW_FUZZER_CHECK(!(TWMessageBarFuzzerIsHighSurrogate(characters[clampedLength - 1]) && TWMessageBarFuzzerIsLowSurrogate(characters[clampedLength])));
+    }
+}
+
+/*
+ * Input layout: two bytes of character cap, one byte of line cap, one byte of line height (quarter points),
+ * one byte of window height (4pt steps), then UTF-16 units in host order. The caps range past the hard bounds.
+ */
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    if (size < TW_FUZZER_HEADER_SIZE)
+    {
+        return 0;
+    }
+    size_t maximumCharacters = ((size_t)data[0] | ((size_t)data[1] << 8)) % (TW_TEXT_MAXIMUM_CHARACTERS * 2);
+    size_t maximumLines = data[2] % (TW_TEXT_MAXIMUM_LINES * 2); // 0 is one line
+    double lineHeight = 1.0 + (data[3] / 4.0);
+    double windowHeight = data[4] * 4.0;
+    
+    static uint16_t characters[TW_FUZZER_MAXIMUM_UNITS];
+    size_t length = (size - TW_FUZZER_HEADER_SIZE) / sizeof(uint16_t);
+    length = length < TW_FUZZER_MAXIMUM_UNITS ? length : TW_FUZZER_MAXIMUM_UNITS;
+    memcpy(characters, data + TW_FUZZER_HEADER_SIZE, length * sizeof(uint16_t));
+    
+    // Scan: every vector path agrees with the reference on the raw input
+    TWMessageBarFuzzerCheckScan(TWMessageBarTextScanCharacters(characters, length), characters, length);
+    
+    // Measurement: the caps it applies are the caller's, bounded by the hard limits
+    size_t boundedCharacters = maximumCharacters < TW_TEXT_MAXIMUM_CHARACTERS ? maximumCharacters : TW_TEXT_MAXIMUM_CHARACTERS;
+    size_t boundedLines = maximumLines == 0 ? 1 : (maximumLines < TW_TEXT_MAXIMUM_LINES ? maximumLines : TW_TEXT_MAXIMUM_LINES);
+    TWMessageBarTextMeasurement measurement = TWMessageBarTextMeasure(characters, length, maximumCharacters, maximumLines);
+    TWMessageBarFuzzerCheckClamp(characters, length, measurement.length, boundedCharacters, boundedLines);
+    TW_FUZZER_CHECK(measurement.length == TWMessageBarTextClampedLength(characters, length, boundedCharacters, boundedLines));
+    TWMessageBarFuzzerCheckScan(measurement.scan, characters, measurement.length);
+    
+    size_t lineBreakCount = 0;
+    for (size_t i = 0; i < measurement.length; i++)
+    {
+        lineBreakCount += TWMessageBarFuzzerIsLineBreak(characters[i]);
+    }
+    TW_FUZZER_CHECK(measurement.lineCount == (measurement.length > 0 ? lineBreakCount + 1 : 0));
+    TW_FUZZER_CHECK(measurement.lineCount <= boundedLines);
+    
+    // Work: bounded by the hard character limit, whatever the input length or caps
+    TW_FUZZER_CHECK(measurement.unitsRead <= TW_TEXT_MAXIMUM_CHARACTERS);
+    TW_FUZZER_CHECK(measurement.unitsRead <= length);
+    TW_FUZZER_CHECK(measurement.unitsRead >= measurement.length);
+    if (length > TW_TEXT_MAXIMUM_CHARACTERS)
+    {
+        // Nothing past the bound can change the result, so nothing past it needs reading
+        for (size_t i = TW_TEXT_MAXIMUM_CHARACTERS; i < length; i++)
+        {
+            characters[i] = (i & 1) ? '\n' : 0xD800;
+        }
+        TWMessageBarTextMeasurement tailMeasurement = TWMessageBarTextMeasure(characters, length, maximumCharacters, maximumLines);
+        TW_FUZZER_CHECK(memcmp(&tailMeasurement, &measurement, sizeof(measurement)) == 0);
+    }
+    
+    // Height: within both the line cap and the window's share, and never below the icon
+    double maximumTextHeight = TWMessageBarTextMaximumHeight(windowHeight, TW_FUZZER_HEIGHT_RATIO, TW_FUZZER_PADDING, TW_FUZZER_MINIMUM_HEIGHT);
+    TW_FUZZER_CHECK(maximumTextHeight >= TW_FUZZER_MINIMUM_HEIGHT);
+    TW_FUZZER_CHECK(maximumTextHeight <= windowHeight * TW_FUZZER_HEIGHT_RATIO || maximumTextHeight == TW_FUZZER_MINIMUM_HEIGHT);
+    double height = TWMessageBarTextBoundedHeight(measurement.lineCount, lineHeight, maximumTextHeight);
+    TW_FUZZER_CHECK(height >= 0.0);
+    TW_FUZZER_CHECK(height <= maximumTextHeight);
+    TW_FUZZER_CHECK(height <= ceil((double)boundedLines * lineHeight));
+    TW_FUZZER_CHECK(height <= TWMessageBarTextBoundedHeight(boundedLines, lineHeight, maximumTextHeight));
+    return 0;
+}
+
+#ifndef TW_MESSAGE_BAR_LIBFUZZER
+
+// Standalone driver
+
+static uint64_t kTWMessageBarFuzzerState = 0x9E3779B97F4A7C15ULL;
+
+static uint64_t TWMessageBarFuzzerRandom(void)
+{
+    kTWMessageBarFuzzerState ^= kTWMessageBarFuzzerState << 13;
+    kTWMessageBarFuzzerState ^= kTWMessageBarFuzzerState >> 7;
+    kTWMessageBarFuzzerState ^= kTWMessageBarFuzzerState << 17;
+    return kTWMessageBarFuzzerState;
+}
+
+static uint16_t TWMessageBarFuzzerRandomCharacter(void)
+{
+    // Weighted toward what the clamp and scan care about: line breaks, both halves of surrogate pairs and class edges
+    static const uint16_t interesting[] = {'\n', 0x2028, 0xD800, 0xDBFF, 0xDC00, 0xDFFF, 'a', ' ', 0x007F, 0x0080, 0x0300, 0x036F, 0x0370, 0x0590};
+    uint64_t random = TWMessageBarFuzzerRandom();
+    if ((random & 3) != 0)
+    {
+        return interesting[(random >> 2) % (sizeof(interesting) / sizeof(*interesting))];
+    }
+    return (uint16_t)(random >> 16);
+}
+
+static int TWMessageBarFuzzerReplayFile(const char *path)
+{
+    FILE *file = fopen(path, "rb");
+    if (!file)
+    {
+        fprintf(stderr, "can't open %s\n", path);
+        return 0;
+    }
+    static uint8_t data[TW_FUZZER_HEADER_SIZE + (TW_FUZZER_MAXIMUM_UNITS * sizeof(uint16_t))];
+    size_t size = fread(data, 1, sizeof(data), file);
+    fclose(file);
+    LLVMFuzzerTestOneInput(data, size);
+    return 1;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc > 1)
+    {
+        int replayed = 1;
+        for (int i = 1; i < argc; i++)
+        {
+            replayed &= TWMessageBarFuzzerReplayFile(argv[i]);
+        }
+        return replayed ? 0 : 1;
+    }
+    
+    static uint8_t data[TW_FUZZER_HEADER_SIZE + (TW_FUZZER_MAXIMUM_UNITS * sizeof(uint16_t))];
+    for (size_t input = 0; input < TW_FUZZER_GENERATED_INPUT_COUNT; input++)
+    {
+        // Mostly short inputs with small caps, so the caps are actually reached
+        size_t length = TWMessageBarFuzzerRandom() % ((input % 16) == 0 ? TW_FUZZER_MAXIMUM_UNITS : 64);
+        uint64_t caps = TWMessageBarFuzzerRandom();
+        data[0] = (uint8_t)(caps % ((input % 16) == 0 ? 256 : 72));
+        data[1] = (input % 16) == 0 ? (uint8_t)(caps >> 8) : 0;
+        data[2] = (input % 16) == 0 ? (uint8_t)(caps >> 16) : (uint8_t)(caps >> 16) % 8;
+        data[3] = (uint8_t)(caps >> 24);
+        data[4] = (uint8_t)(caps >> 32);
+        int sparseLineBreaks = (input % 32) == 0; // long inputs whose line cap isn't reached first, so the character bound is
+        for (size_t i = 0; i < length; i++)
+        {
+            uint16_t character = TWMessageBarFuzzerRandomCharacter();
+            if (sparseLineBreaks && TWMessageBarFuzzerIsLineBreak(character) && (TWMessageBarFuzzerRandom() % 64) != 0)
+            {
+                character = 'a';
+            }
+            memcpy(data + TW_FUZZER_HEADER_SIZE + (i * sizeof(uint16_t)), &character, sizeof(uint16_t));
+        }
+        LLVMFuzzerTestOneInput(data, TW_FUZZER_HEADER_SIZE + (length * sizeof(uint16_t)));
+    }
+    return 0;
+}
+
+#endif
@@ -0,0 +1,51 @@
+//
+//  TWMessageBarTextReference.h
+//
+//  Created by Terry Worona on 5/13/13.
+//  Copyright (c) 2013 Terry Worona. All rights reserved.
+//
+//  Plain scalar versions of TWMessageBarTextScanCharacters and TWMessageBarTextClampedLength, one unit at a time.
+//  The text tests and the fuzzer hold the core to them.
+//
+
+#ifndef TWMessageBarTextReference_h
+#define TWMessageBarTextReference_h
+
+#include "TWMessageBarCore.h"
+
+static inline TWMessageBarTextScan TWMessageBarTextScanReference(const uint16_t *characters, size_t length)
+{
+    TWMessageBarTextScan scan = {0, 1, 0};
+    for (size_t i = 0; i < length; i++)
+    {
+        uint16_t character = characters[i];
+        scan.newlineCount += character == '\n';
+        scan.asciiOnly &= character < 0x0080;
+        scan.complex |= (character >= 0x0300 && character <= 0x036F) || character >= 0x0590;
+    }
+    return scan;
+}
+
+static inline size_t TWMessageBarTextClampedLengthReference(const uint16_t *characters, size_t length, size_t maximumCharacters, size_t maximumLines)
+{
+    size_t lines = 1;
+    size_t i = 0;
+    for (; i < length && i < maximumCharacters; i++)
+    {
+        if (characters[i] == '\n' || characters[i] == 0x2028)
+        {
+            if (lines == maximumLines)
+            {
+                return i;
+            }
+            lines++;
+        }
+    }
+    if (i < length && i > 0 && characters[i - 1] >= 0xD800 && characters[i - 1] <= 0xDBFF)
+    {
+        i--;
+    }
+    return i;
+}
+
+#endif
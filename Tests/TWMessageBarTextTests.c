@@ -0,0 +1,130 @@
+//
+//  TWMessageBarTextTests.c
+//
+//  Created by Terry Worona on 5/13/13.
+//  Copyright (c) 2013 Terry Worona. All rights reserved.
+//
+//  Compares the text scan and clamp against plain scalar references. The scan takes its NEON path on arm64
+//  and its SSE2 path on x86, so this runs on both (see cmake/aarch64-linux-gnu.cmake for qemu).
+//
+
+#include "TWMessageBarCore.h"
+#include "TWMessageBarTest.h"
+#include "TWMessageBarTextReference.h"
+
+#include <stdlib.h>
+
+// Numerics
+#define TW_TEXT_TEST_MAXIMUM_LENGTH 300 // every vector tail length, many times over
+#define TW_TEXT_TEST_ITERATIONS 20
+#define TW_TEXT_TEST_LONG_LENGTH 600000 // past the point where per-lane newline counts are flushed
+
+static uint64_t kTWMessageBarTextTestState = 0x2545F4914F6CDD1DULL;
+
+static uint64_t TWMessageBarTextTestRandom(void)
+{
+    kTWMessageBarTextTestState ^= kTWMessageBarTextTestState << 13;
+    kTWMessageBarTextTestState ^= kTWMessageBarTextTestState >> 7;
+    kTWMessageBarTextTestState ^= kTWMessageBarTextTestState << 17;
+    return kTWMessageBarTextTestState;
+}
+
+static uint16_t TWMessageBarTextTestRandomCharacter(void)
+{
+    // Each class boundary the scan tests, from both sides, plus arbitrary units
+    static const uint16_t boundaries[] = {
+        '\n', 0x2028, 'a', 0x007F, 0x0080, 0x00E9, 0x02FF, 0x0300, 0x036F, 0x0370, 0x058F, 0x0590, 0xD83D, 0xDE00, 0xFFFF
+    };
+    uint64_t random = TWMessageBarTextTestRandom();
+    if ((random & 7) < 5)
+    {
+        return 'a' + (uint16_t)((random >> 3) % 26);
+    }
+    if ((random & 7) < 7)
+    {
+        return boundaries[(random >> 3) % (sizeof(boundaries) / sizeof(*boundaries))];
+    }
+    return (uint16_t)(random >> 16);
+}
+
+static void TWMessageBarTextTestAssertScan(const uint16_t *characters, size_t length)
+{
+    TWMessageBarTextScan scan = TWMessageBarTextScanCharacters(characters, length);
+    TWMessageBarTextScan reference = TWMessageBarTextScanReference(characters, length);
+    TW_ASSERT_EQUAL(scan.newlineCount, reference.newlineCount);
+    TW_ASSERT_EQUAL(scan.asciiOnly, reference.asciiOnly);
+    TW_ASSERT_EQUAL(scan.complex, reference.complex);
+}
+
+// Tests
+
+static void TWMessageBarTestScanMatchesReference(void)
+{
+    uint16_t characters[TW_TEXT_TEST_MAXIMUM_LENGTH];
+    for (size_t iteration = 0; iteration < TW_TEXT_TEST_ITERATIONS; iteration++)
+    {
+        for (size_t length = 0; length <= TW_TEXT_TEST_MAXIMUM_LENGTH; length++)
+        {
+            for (size_t i = 0; i < length; i++)
+            {
+                characters[i] = iteration < 2 ? 'a' : TWMessageBarTextTestRandomCharacter();
+            }
+            
+            // A single special unit in every lane position, vector body and tail alike
+            if (iteration == 1 && length > 0)
+            {
+                characters[length - 1] = (uint16_t)(0x0590 + length);
+            }
+            TWMessageBarTextTestAssertScan(characters, length);
+        }
+    }
+}
+
+static void TWMessageBarTestScanCountsLongInput(void)
+{
+    uint16_t *characters = malloc(TW_TEXT_TEST_LONG_LENGTH * sizeof(uint16_t));
+    TW_ASSERT(characters != NULL);
+    if (!characters)
+    {
+        return;
+    }
+    for (size_t i = 0; i < TW_TEXT_TEST_LONG_LENGTH; i++)
+    {
+        characters[i] = '\n';
+    }
+    TWMessageBarTextTestAssertScan(characters, TW_TEXT_TEST_LONG_LENGTH);
+    for (size_t i = 0; i < TW_TEXT_TEST_LONG_LENGTH; i++)
+    {
+        characters[i] = TWMessageBarTextTestRandomCharacter();
+    }
+    TWMessageBarTextTestAssertScan(characters, TW_TEXT_TEST_LONG_LENGTH);
+    free(characters);
+}
+
+static void TWMessageBarTestClampMatchesReference(void)
+{
+    uint16_t characters[TW_TEXT_TEST_MAXIMUM_LENGTH];
+    for (size_t iteration = 0; iteration < TW_TEXT_TEST_ITERATIONS * 10; iteration++)
+    {
+        size_t length = TWMessageBarTextTestRandom() % TW_TEXT_TEST_MAXIMUM_LENGTH;
+        for (size_t i = 0; i < length; i++)
+        {
+            characters[i] = TWMessageBarTextTestRandomCharacter();
+        }
+        for (size_t maximumCharacters = 0; maximumCharacters <= length + 1; maximumCharacters += 1 + (maximumCharacters / 8))
+        {
+            for (size_t maximumLines = 1; maximumLines <= 8; maximumLines++)
+            {
+                TW_ASSERT_EQUAL(TWMessageBarTextClampedLength(characters, length, maximumCharacters, maximumLines), TWMessageBarTextClampedLengthReference(characters, length, maximumCharacters, maximumLines));
+            }
+        }
+    }
+}
+
+int main(void)
+{
+    TW_RUN_TEST(TWMessageBarTestScanMatchesReference);
+    TW_RUN_TEST(TWMessageBarTestScanCountsLongInput);
+    TW_RUN_TEST(TWMessageBarTestClampMatchesReference);
+    return TWMessageBarTestFailureCount > 0 ? 1 : 0;
+}